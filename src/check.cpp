@@ -0,0 +1,83 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+#include "check.h"
+
+#include <vector>
+//---------------------------------------------------------------------------
+
+Check::Check(const char name[], bool enabledByDefault, CreateFileCheck create)
+    : _name(name), _enabledByDefault(enabledByDefault), _create(create)
+{
+    // Keep the checks sorted by name
+    std::list<const Check *>::iterator it = instances().begin();
+    while (it != instances().end() && (*it)->name() < _name)
+        ++it;
+    instances().insert(it, this);
+}
+
+Check::~Check()
+{
+    instances().remove(this);
+}
+
+std::list<const Check *> &Check::instances()
+{
+    static std::list<const Check *> checks;
+    return checks;
+}
+//---------------------------------------------------------------------------
+
+void runCheck(const Tokenizer &tokenizer, FileCheck &check)
+{
+    for (const Token *tok = tokenizer.tokens; tok; tok = tok->next)
+        check.visit(tok);
+    check.finish();
+}
+//---------------------------------------------------------------------------
+
+void runChecks(const Tokenizer &tokenizer, const CheckContext &context, std::ostream &errout)
+{
+    // Create the enabled checks..
+    std::vector<FileCheck *> checks;
+    for (std::list<const Check *>::const_iterator it = Check::instances().begin(); it != Check::instances().end(); ++it)
+    {
+        if ((*it)->enabledByDefault() || context.pOptions->EnabledChecks.count((*it)->name()))
+        {
+            FileCheck * const check = (*it)->create(tokenizer, context, errout);
+            if (check)
+                checks.push_back(check);
+        }
+    }
+
+    // Feed the tokens to all checks in one pass..
+    for (const Token *tok = tokenizer.tokens; tok; tok = tok->next)
+    {
+        for (unsigned int i = 0; i < checks.size(); ++i)
+            checks[i]->visit(tok);
+    }
+
+    for (unsigned int i = 0; i < checks.size(); ++i)
+    {
+        checks[i]->finish();
+        delete checks[i];
+    }
+}
+//---------------------------------------------------------------------------
+
@@ -0,0 +1,135 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+//---------------------------------------------------------------------------
+#ifndef checkH
+#define checkH
+//---------------------------------------------------------------------------
+
+#include "tokenize.h"
+
+#include <list>
+#include <ostream>
+#include <set>
+#include <string>
+
+class FixIts;
+class HeaderUsage;
+class SymbolCache;
+
+// Data that is shared by the checks of all checked source files
+struct CheckContext
+{
+    CheckContext(const Options *options, SymbolCache *cache, std::set<std::string> *includes,
+                 FixIts *fixes = NULL, std::set<std::string> *unneeded = NULL,
+                 HeaderUsage *usage = NULL)
+        : pOptions(options), symbolCache(cache), checkedIncludes(includes), fixIts(fixes),
+          unneededIncludes(unneeded), headerUsage(usage)
+    { }
+
+    const Options *pOptions;
+    SymbolCache *symbolCache;                 // symbols of headers
+    std::set<std::string> *checkedIncludes;   // includes in headers that have been checked
+    FixIts *fixIts;                           // fixes for the errors. NULL => no fixes
+    std::set<std::string> *unneededIncludes;  // "file:line" of the includes that are not needed, not even indirectly
+    HeaderUsage *headerUsage;                 // used symbols of the headers. NULL => not collected
+};
+
+/**
+ * Checking of one tokenized source file. visit() is called for each token
+ * in order and then finish() is called.
+ */
+class FileCheck
+{
+public:
+    virtual ~FileCheck()
+    { }
+
+    virtual void visit(const Token *tok) = 0;
+
+    virtual void finish() = 0;
+};
+
+typedef FileCheck *(*CreateFileCheck)(const Tokenizer &tokenizer,
+                                      const CheckContext &context,
+                                      std::ostream &errout);
+
+/**
+ * A check. The checks register themselves by creating a static Check
+ * object, the enabled checks are run by runChecks().
+ */
+class Check
+{
+public:
+    /**
+     * register a check
+     * @param name name that is used with --enable
+     * @param enabledByDefault is the check run without --enable
+     * @param create create the check for a tokenized file. NULL if the
+     *               check is done by another check when it is enabled in
+     *               Options::EnabledChecks.
+     */
+    Check(const char name[], bool enabledByDefault, CreateFileCheck create);
+    ~Check();
+
+    /** all registered checks */
+    static std::list<const Check *> &instances();
+
+    const std::string &name() const
+    {
+        return _name;
+    }
+
+    bool enabledByDefault() const
+    {
+        return _enabledByDefault;
+    }
+
+    FileCheck *create(const Tokenizer &tokenizer, const CheckContext &context,
+                      std::ostream &errout) const
+    {
+        return _create ? _create(tokenizer, context, errout) : NULL;
+    }
+
+private:
+    // No copying
+    Check(const Check &);
+    Check &operator=(const Check &);
+
+    const std::string _name;
+    const bool _enabledByDefault;
+    const CreateFileCheck _create;
+};
+
+/** feed all tokens to a check */
+void runCheck(const Tokenizer &tokenizer, FileCheck &check);
+
+/**
+ * run the enabled checks on a tokenized file. The tokens are traversed
+ * once and each token is fed to all the checks.
+ * @param tokenizer tokenized source file
+ * @param context options and shared data. The checks that are enabled by
+ *                default and the checks in Options::EnabledChecks are run.
+ * @param errout error stream
+ */
+void runChecks(const Tokenizer &tokenizer, const CheckContext &context, std::ostream &errout);
+
+//---------------------------------------------------------------------------
+#endif
+
@@ -18,38 +18,81 @@
 
 //---------------------------------------------------------------------------
 #include "checkheaders.h"
+#include "check.h"
 #include "tokenize.h"
 #include "commoncheck.h"
+#include "symbolcache.h"
+#include "fixit.h"
+#include "headerusage.h"
 #include <algorithm>
 #include <set>
 #include <list>
 #include <sstream>
 #include <string>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 //---------------------------------------------------------------------------
 
+// Token patterns used by the checks. They are parsed once.
+static const Pattern implementationBegin(") {");
+static const Pattern typedefName("%var% ;");
+static const Pattern baseClass(": %var% {");
+static const Pattern baseClassAccess(": %type% %var% {");
+static const Pattern pointerVariable("%type% * %var%");
+static const Pattern pointerVariableEnd("[,;()[]");
+static const Pattern structKeyword("struct");
+static const Pattern classKeyword("class");
+static const Pattern openBrace("{");
+//---------------------------------------------------------------------------
+
 
 //---------------------------------------------------------------------------
 // HEADERS - No implementation in a header
 //---------------------------------------------------------------------------
 
-void WarningHeaderWithImplementation(const Tokenizer &tokenizer, OutputFormat outputFormat, std::ostream &errout)
+class HeaderWithImplementation : public FileCheck
 {
-    for (const Token *tok = tokenizer.tokens; tok; tok = tok->next)
+public:
+    HeaderWithImplementation(const Tokenizer &t, const Options *options, std::ostream &e)
+        : tokenizer(t), pOptions(options), errout(e)
+    { }
+
+    void visit(const Token *tok)
     {
         // Only interested in included file
         if (tok->FileIndex == 0)
-            continue;
+            return;
 
-        if (Match(tok, ") {"))
+        if (Match(tok, implementationBegin))
         {
             std::ostringstream ostr;
             ostr << "Found implementation in header";
-            ReportErr(tokenizer, outputFormat, tok, "HeaderWithImplementation", ostr.str(), errout);
+            ReportErr(tokenizer, pOptions->outputFormat, tok, "HeaderWithImplementation", ostr.str(), errout);
         }
     }
+
+    void finish()
+    { }
+
+private:
+    const Tokenizer &tokenizer;
+    const Options * const pOptions;
+    std::ostream &errout;
+};
+
+void WarningHeaderWithImplementation(const Tokenizer &tokenizer, const Options *pOptions, std::ostream &errout)
+{
+    HeaderWithImplementation check(tokenizer, pOptions, errout);
+    runCheck(tokenizer, check);
+}
+
+static FileCheck *createHeaderWithImplementation(const Tokenizer &tokenizer, const CheckContext &context, std::ostream &errout)
+{
+    return new HeaderWithImplementation(tokenizer, context.pOptions, errout);
 }
+
+static const Check headerWithImplementation("implementation", false, createHeaderWithImplementation);
 //---------------------------------------------------------------------------
 
 
@@ -60,20 +103,220 @@ void WarningHeaderWithImplementation(const Tokenizer &tokenizer, OutputFormat ou
 // HEADERS - Unneeded include
 //---------------------------------------------------------------------------
 
-static std::string matchSymbols(const std::set<std::string> &needed, const std::set<std::string> & classes, const std::set<std::string> & names)
+// Kinds of tokens that the symbol extraction cares about. The keywords
+// are names too, they have the kinds after TK_NAME.
+enum TokenKind
 {
-    for (std::set<std::string>::const_iterator sym = needed.begin(); sym != needed.end(); ++sym)
+    TK_END,         // no token
+    TK_OTHER,
+    TK_STRING,
+    TK_SEMICOLON,
+    TK_BRACKET,
+    TK_ASSIGN,
+    TK_PAREN,
+    TK_BRACE,
+    TK_COLON,
+    TK_STAR,
+    TK_DEFINE,
+    TK_NAME,
+    TK_CLASS,
+    TK_STRUCT,
+    TK_NAMESPACE,
+    TK_EXTERN,
+    TK_ENUM,
+    TK_TYPEDEF
+};
+
+static const struct
+{
+    const char *str;
+    TokenKind kind;
+} keywords[] =
+{
+    { "class",     TK_CLASS     },
+    { "struct",    TK_STRUCT    },
+    { "namespace", TK_NAMESPACE },
+    { "extern",    TK_EXTERN    },
+    { "enum",      TK_ENUM      },
+    { "typedef",   TK_TYPEDEF   },
+    { "#define",   TK_DEFINE    },
+    { NULL,        TK_OTHER     }
+};
+
+static TokenKind tokenKind(const Token *tok)
+{
+    if (!tok)
+        return TK_END;
+
+    const char *str = tok->str;
+    if (str[0] == '\"')
+        return TK_STRING;
+
+    if (str[1] == 0)
     {
-        if (classes.find(*sym) != classes.end())
-            return *sym;
+        switch (str[0])
+        {
+        case ';':
+            return TK_SEMICOLON;
+        case '[':
+            return TK_BRACKET;
+        case '=':
+            return TK_ASSIGN;
+        case '(':
+            return TK_PAREN;
+        case '{':
+            return TK_BRACE;
+        case ':':
+            return TK_COLON;
+        case '*':
+            return TK_STAR;
+        }
     }
-    for (std::set<std::string>::const_iterator sym = needed.begin(); sym != needed.end(); ++sym)
+
+    if (!IsName(str) && str[0] != '#')
+        return TK_OTHER;
+
+    for (unsigned int i = 0; keywords[i].str; ++i)
     {
-        if (names.find(*sym) != names.end())
-            return *sym;
+        if (str[0] == keywords[i].str[0] && strcmp(str, keywords[i].str) == 0)
+            return keywords[i].kind;
     }
-    return "";
+    return (str[0] == '#') ? TK_OTHER : TK_NAME;
+}
+
+static bool isName(TokenKind kind)
+{
+    return bool(kind >= TK_NAME);
+}
+
+// Does the token end a variable declaration: "x ;", "x [" or "x ="
+static bool isDeclarationEnd(TokenKind kind)
+{
+    return bool(kind == TK_SEMICOLON || kind == TK_BRACKET || kind == TK_ASSIGN);
+}
+
+/**
+ * Extract the symbols that are declared at a token in a header. The rule
+ * is selected by the kind of the token, and the following tokens are
+ * only classified once.
+ * @param tok token at indentlevel 0
+ * @param sym the extracted symbols are added here
+ * @param symbolCache symbol ids
+ * @return the last token that was handled
+ */
+static const Token *extractSymbols(const Token *tok, HeaderSymbols &sym, SymbolCache &symbolCache)
+{
+    // The token and the tokens after it..
+    const Token *t[5];
+    TokenKind k[5];
+    t[0] = tok;
+    k[0] = tokenKind(tok);
+    for (unsigned int i = 1; i < 5; ++i)
+    {
+        t[i] = t[i-1] ? t[i-1]->next : NULL;
+        k[i] = tokenKind(t[i]);
+    }
+
+    switch (k[0])
+    {
+    // Class declaration "class X {", "class X :", "struct X {" or
+    // forward declaration "class X ;"..
+    case TK_CLASS:
+    case TK_STRUCT:
+        if (isName(k[1]) && k[3] != TK_END)
+        {
+            if (k[2] == TK_BRACE || (k[2] == TK_COLON && k[0] == TK_CLASS))
+            {
+                sym.classes.push_back(symbolCache.getId(t[1]->str));
+                return tok;
+            }
+            if (k[2] == TK_SEMICOLON)
+            {
+                // This type name is probably needed in any files that includes this file
+                sym.declarations.push_back(symbolCache.getId(t[1]->str));
+                return tok;
+            }
+        }
+        break;
+
+    // Namespace "namespace X {" or "extern "C" {", the contents are extracted..
+    case TK_NAMESPACE:
+        if (isName(k[1]) && k[2] == TK_BRACE && k[3] != TK_END)
+            return t[2];
+        break;
+
+    case TK_EXTERN:
+        if (k[1] == TK_STRING && k[2] == TK_BRACE && k[3] != TK_END)
+            return t[2];
+        break;
+
+    // #define..
+    case TK_DEFINE:
+        if (isName(k[1]) && k[2] != TK_END)
+            sym.names.push_back(symbolCache.getId(t[1]->str));
+        return tok;
+
+    default:
+        break;
+    }
+
+    if (!isName(k[0]))
+        return tok;
+
+    // Variable declaration..
+    if (isName(k[1]) && isDeclarationEnd(k[2]) && k[3] != TK_END)
+    {
+        sym.names.push_back(symbolCache.getId(t[1]->str));
+        return tok;
+    }
+
+    if (k[1] == TK_STAR && isName(k[2]) && isDeclarationEnd(k[3]) && k[4] != TK_END)
+    {
+        sym.names.push_back(symbolCache.getId(t[2]->str));
+        return tok;
+    }
+
+    // enum..
+    if (k[0] == TK_ENUM)
+    {
+        tok = tok->next;
+        while (tok->next && tok->str[0]!=';')
+        {
+            if (IsName(tok->str))
+                sym.names.push_back(symbolCache.getId(tok->str));
+            tok = tok->next;
+        }
+        return tok;
+    }
+
+    // function..
+    if ((isName(k[1]) && k[2] == TK_PAREN && k[3] != TK_END) ||
+        (k[1] == TK_STAR && isName(k[2]) && k[3] == TK_PAREN && k[4] != TK_END))
+    {
+        tok = (k[1] == TK_STAR) ? t[2] : t[1];
+        sym.names.push_back(symbolCache.getId(tok->str));
+        while (tok->next && tok->str[0] != ')')
+            tok = tok->next;
+        return tok;
+    }
+
+    // typedef..
+    if (k[0] == TK_TYPEDEF)
+    {
+        if (k[1] == TK_ENUM)
+            return tok;
+        while (tok->str[0] != ';' && tok->next)
+        {
+            if (Match(tok, typedefName))
+                sym.names.push_back(symbolCache.getId(tok->str));
+
+            tok = tok->next;
+        }
+    }
+
+    return tok;
 }
+//---------------------------------------------------------------------------
 
 class IncludeInfo
 {
@@ -94,264 +337,946 @@ public:
     unsigned int hfile;
 };
 
-static void getincludes(const std::vector< std::list<IncludeInfo> > &includes, const unsigned int hfile, std::set<unsigned int> &result, bool &notfound)
+// Set of file indexes
+class FileSet
 {
-    if (hfile < includes.size())
+public:
+    explicit FileSet(unsigned int size) : bits((size + 31) / 32, 0), count(size)
+    { }
+
+    void insert(unsigned int i)
     {
-        for (std::list<IncludeInfo>::const_iterator it = includes[hfile].begin(); it != includes[hfile].end(); ++it)
-        {
-            if (it->hfile >= includes.size())
-                notfound = true;
-            else if (result.find(it->hfile) == result.end())
-            {
-                result.insert(it->hfile);
-                getincludes(includes, it->hfile, result, notfound);
-            }
-        }
+        bits[i / 32] |= 1U << (i % 32);
     }
-}
 
-void WarningIncludeHeader(const Tokenizer &tokenizer, const Options *pOptions,
-                          std::ostream &errout)
-{
-    // A header is needed if:
-    // * It contains some needed class declaration
-    // * It contains some needed function declaration
-    // * It contains some needed constant value
-    // * It contains some needed variable
-    // * It contains some needed enum
+    bool contains(unsigned int i) const
+    {
+        return bool((bits[i / 32] >> (i % 32)) & 1U);
+    }
 
+    void merge(const FileSet &other)
+    {
+        for (unsigned int w = 0; w < bits.size(); ++w)
+            bits[w] |= other.bits[w];
+    }
 
-    // Extract all includes..
-    std::vector< std::list<IncludeInfo> > includes(tokenizer.ShortFileNames.size(), std::list< IncludeInfo >());
-    for (const Token *tok = tokenizer.tokens; tok; tok = tok->next)
+    // Get the first file index >= i in the set. size() if there is none.
+    unsigned int next(unsigned int i) const
     {
-        if (strncmp(tok->str, "#include", 8) == 0)
+        while (i < count)
         {
-            // Get index of included file:
-            unsigned int hfile;
-            const char *includefile = tok->next->str;
-            for (hfile = 0; hfile < tokenizer.ShortFileNames.size(); ++hfile)
-            {
-                if (SameFileName(tokenizer.ShortFileNames[hfile].c_str(), includefile))
-                    break;
-            }
-            includes[tok->FileIndex].push_back(IncludeInfo(tok, hfile));
+            const unsigned int word = bits[i / 32] >> (i % 32);
+            if (word == 0)
+                i = (i / 32 + 1) * 32;
+            else if (word & 1U)
+                return i;
+            else
+                ++i;
         }
+        return count;
     }
 
-    // System headers are checked differently..
-    std::vector<unsigned int> SystemHeaders(tokenizer.ShortFileNames.size(), 0);
-    for (const Token *tok = tokenizer.tokens; tok; tok = tok->next)
+    // Get the first file index >= i that is in both sets. size() if there is none.
+    unsigned int nextCommon(const FileSet &other, unsigned int i) const
     {
-        if (strcmp(tok->str, "#include<>") == 0 ||
-            (SystemHeaders[tok->FileIndex] && strcmp(tok->str, "#include") == 0))
+        while (i < count)
         {
-            // Get index of included file:
-            const char *includefile = tok->next->str;
-            for (unsigned int hfile = 0; hfile < tokenizer.ShortFileNames.size(); ++hfile)
-            {
-                if (SameFileName(tokenizer.ShortFileNames[hfile].c_str(), includefile))
-                {
-                    SystemHeaders[hfile] = 1;
-                    break;
-                }
-            }
+            const unsigned int word = (bits[i / 32] & other.bits[i / 32]) >> (i % 32);
+            if (word == 0)
+                i = (i / 32 + 1) * 32;
+            else if (word & 1U)
+                return i;
+            else
+                ++i;
         }
+        return count;
     }
 
+    unsigned int size() const
+    {
+        return count;
+    }
 
-    // extracted class names..
-    std::vector< std::set<std::string> > classes(tokenizer.ShortFileNames.size(), std::set<std::string>());
+private:
+    std::vector<unsigned int> bits;
+    unsigned int count;
+};
 
-    // extracted symbol names..
-    std::vector< std::set<std::string> > names(tokenizer.ShortFileNames.size(), std::set<std::string>());
+/**
+ * The files that each file includes directly or indirectly. The include
+ * graph is stored as flat adjacency arrays, files that include each other
+ * are collapsed into one component and the closure of each component is
+ * calculated once.
+ */
+class IncludeClosures
+{
+public:
+    explicit IncludeClosures(const std::vector< std::list<IncludeInfo> > &includes);
 
-    // needed symbol/type names
-    std::vector< std::set<std::string> > needed(tokenizer.ShortFileNames.size(), std::set<std::string>());
+    // All files included by the file directly or indirectly, including the file itself
+    const FileSet &get(unsigned int file) const
+    {
+        return closure[component[file]];
+    }
 
-    // symbol/type names that need at least a forward declaration
-    std::vector< std::set<std::string> > needDeclaration(tokenizer.ShortFileNames.size(), std::set<std::string>());
+    // Is there an include that is not found in the file or in the files it includes?
+    bool notFound(unsigned int file) const
+    {
+        return notfound[component[file]];
+    }
+
+private:
+    std::vector<unsigned int> component;
+    std::vector<FileSet> closure;
+    std::vector<bool> notfound;
+};
+
+IncludeClosures::IncludeClosures(const std::vector< std::list<IncludeInfo> > &includes)
+{
+    const unsigned int n = includes.size();
 
-    // Extract symbols from the files..
+    // Adjacency arrays: the includes of file f are targets[offsets[f]] .. targets[offsets[f+1]-1]
+    std::vector<unsigned int> offsets(n + 1, 0);
+    std::vector<unsigned int> targets;
+    std::vector<bool> unresolved(n, false);
+    for (unsigned int f = 0; f < n; ++f)
     {
-        unsigned int indentlevel = 0;
-        for (const Token *tok = tokenizer.tokens; tok; tok = tok->next)
+        offsets[f] = targets.size();
+        for (std::list<IncludeInfo>::const_iterator it = includes[f].begin(); it != includes[f].end(); ++it)
         {
-            // Don't extract symbols in the main source file
-            if (tok->FileIndex == 0)
-                continue;
-
-            if (tok->next && tok->FileIndex != tok->next->FileIndex)
-                indentlevel = 0;
+            if (it->hfile < n)
+                targets.push_back(it->hfile);
+            else
+                unresolved[f] = true;
+        }
+    }
+    offsets[n] = targets.size();
+
+    // Find the strongly connected components (Tarjan). A component is
+    // completed after all the components it includes, so the closures
+    // can be calculated directly.
+    const unsigned int unvisited = ~0U;
+    std::vector<unsigned int> index(n, unvisited);
+    std::vector<unsigned int> lowlink(n, 0);
+    std::vector<bool> onStack(n, false);
+    std::vector<unsigned int> stack;
+    std::vector< std::pair<unsigned int, unsigned int> > callstack;   // file, next edge
+    unsigned int counter = 0;
+    component.assign(n, 0);
+
+    for (unsigned int root = 0; root < n; ++root)
+    {
+        if (index[root] != unvisited)
+            continue;
 
-            if (tok->str[0] == '{')
-                indentlevel++;
+        index[root] = lowlink[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = true;
+        callstack.push_back(std::make_pair(root, offsets[root]));
 
-            else if (indentlevel > 0 && tok->str[0] == '}')
-                indentlevel--;
+        while (!callstack.empty())
+        {
+            const unsigned int file = callstack.back().first;
+            const unsigned int edge = callstack.back().second;
 
-            if (indentlevel != 0)
+            if (edge < offsets[file + 1])
+            {
+                ++callstack.back().second;
+                const unsigned int w = targets[edge];
+                if (index[w] == unvisited)
+                {
+                    index[w] = lowlink[w] = counter++;
+                    stack.push_back(w);
+                    onStack[w] = true;
+                    callstack.push_back(std::make_pair(w, offsets[w]));
+                }
+                else if (onStack[w])
+                    lowlink[file] = std::min(lowlink[file], index[w]);
                 continue;
+            }
 
-            // Class or namespace declaration..
-            // --------------------------------------
-            if (Match(tok,"class %var% {") || Match(tok,"class %var% :") || Match(tok,"struct %var% {"))
-                classes[tok->FileIndex].insert(getstr(tok, 1));
-
-            else if (Match(tok, "namespace %var% {") || Match(tok, "extern %str% {"))
+            callstack.pop_back();
+            if (!callstack.empty())
             {
-                tok = gettok(tok,2);
+                const unsigned int parent = callstack.back().first;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[file]);
+            }
+
+            if (lowlink[file] != index[file])
                 continue;
+
+            // New component..
+            const unsigned int c = closure.size();
+            closure.push_back(FileSet(n));
+            notfound.push_back(false);
+            std::vector<unsigned int> members;
+            unsigned int w;
+            do
+            {
+                w = stack.back();
+                stack.pop_back();
+                onStack[w] = false;
+                component[w] = c;
+                closure[c].insert(w);
+                if (unresolved[w])
+                    notfound[c] = true;
+                members.push_back(w);
             }
+            while (w != file);
 
-            else if (Match(tok, "struct %var% ;") || Match(tok, "class %var% ;"))
+            // Add the closures of the included components..
+            for (unsigned int m = 0; m < members.size(); ++m)
             {
-                // This type name is probably needed in any files that includes this file
-                const std::string name(tok->next->str);
-                for (unsigned int i = 0; i < tokenizer.ShortFileNames.size(); ++i)
+                for (unsigned int e = offsets[members[m]]; e < offsets[members[m] + 1]; ++e)
                 {
-                    if (i == tok->FileIndex)
-                        continue;
-                    for (std::list<IncludeInfo>::const_iterator it = includes[i].begin(); it != includes[i].end(); ++it)
+                    const unsigned int other = component[targets[e]];
+                    if (other != c)
                     {
-                        if (it->hfile == tok->FileIndex)
-                        {
-                            needed[it->tok->FileIndex].insert(name);
-                        }
+                        closure[c].merge(closure[other]);
+                        if (notfound[other])
+                            notfound[c] = true;
                     }
                 }
-                continue;
             }
+        }
+    }
+}
 
-            // Variable declaration..
-            // --------------------------------------
-            else if (Match(tok, "%type% %var% ;") || Match(tok, "%type% %var% [") || Match(tok, "%type% %var% ="))
-                names[tok->FileIndex].insert(getstr(tok, 1));
+// No symbol, see SymbolIndex::find
+static const SymbolId NoSymbol = ~0U;
 
-            else if (Match(tok, "%type% * %var% ;") || Match(tok, "%type% * %var% [") || Match(tok, "%type% * %var% ="))
-                names[tok->FileIndex].insert(getstr(tok, 2));
+/**
+ * Inverted symbol index: the headers that declare each symbol. With it the
+ * headers that provide the needed symbols of a file are found with one
+ * lookup per needed symbol, instead of comparing the needed symbols with
+ * the symbols of every header in every include closure.
+ */
+class SymbolIndex
+{
+public:
+    explicit SymbolIndex(const std::vector<const HeaderSymbols *> &symbols);
+
+    /**
+     * Find the headers that declare any of the needed symbols.
+     * @param needed sorted symbol ids
+     * @param classesOnly only look for class declarations
+     * @param found for each header the first needed class that it declares,
+     *              or if there is none the first needed name. NoSymbol for
+     *              headers that don't declare any needed symbol.
+     * @param providers the headers that declare needed symbols
+     */
+    void find(const SymbolIds &needed, bool classesOnly,
+              std::vector<SymbolId> &found, FileSet &providers) const;
+
+private:
+    struct Entry
+    {
+        SymbolId sym;
+        unsigned int file;
+        bool isClass;
 
-            // enum..
-            // --------------------------------------
-            else if (strcmp(tok->str, "enum") == 0)
-            {
-                tok = tok->next;
-                while (tok->next && tok->str[0]!=';')
-                {
-                    if (IsName(tok->str))
-                        names[tok->FileIndex].insert(tok->str);
-                    tok = tok->next;
-                }
-            }
+        bool operator<(const Entry &other) const
+        {
+            return bool(sym < other.sym || (sym == other.sym && file < other.file));
+        }
+    };
 
-            // function..
-            // --------------------------------------
-            else if (Match(tok,"%type% %var% (") ||
-                     Match(tok,"%type% * %var% ("))
-            {
-                tok = tok->next;
-                if (tok->str[0] == '*')
-                    tok = tok->next;
-                names[tok->FileIndex].insert(tok->str);
-                while (tok->next && tok->str[0] != ')')
-                    tok = tok->next;
-            }
+    // Sorted by symbol id
+    std::vector<Entry> entries;
+    unsigned int files;
+};
 
-            // typedef..
-            // --------------------------------------
-            else if (strcmp(tok->str,"typedef")==0)
+SymbolIndex::SymbolIndex(const std::vector<const HeaderSymbols *> &symbols) : files(symbols.size())
+{
+    for (unsigned int file = 0; file < symbols.size(); ++file)
+    {
+        const SymbolIds * const lists[] = { &symbols[file]->classes, &symbols[file]->names };
+        for (unsigned int list = 0; list < 2; ++list)
+        {
+            for (unsigned int k = 0; k < lists[list]->size(); ++k)
             {
-                if (strcmp(getstr(tok,1),"enum")==0)
-                    continue;
-                while (tok->str[0] != ';' && tok->next)
-                {
-                    if (Match(tok, "%var% ;"))
-                        names[tok->FileIndex].insert(tok->str);
-
-                    tok = tok->next;
-                }
+                Entry entry;
+                entry.sym = (*lists[list])[k];
+                entry.file = file;
+                entry.isClass = bool(list == 0);
+                entries.push_back(entry);
             }
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+}
+
+void SymbolIndex::find(const SymbolIds &needed, bool classesOnly,
+                       std::vector<SymbolId> &found, FileSet &providers) const
+{
+    found.assign(files, NoSymbol);
+    std::vector<SymbolId> names(files, NoSymbol);
+    std::vector<unsigned int> matched;
 
-            // #define..
-            // --------------------------------------
-            else if (Match(tok, "#define %var%"))
-                names[tok->FileIndex].insert(tok->next->str);
+    for (SymbolIds::const_iterator sym = needed.begin(); sym != needed.end(); ++sym)
+    {
+        Entry key;
+        key.sym = *sym;
+        key.file = 0;
+        key.isClass = false;
+        for (std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), key);
+             it != entries.end() && it->sym == *sym; ++it)
+        {
+            if (it->isClass ? (found[it->file] != NoSymbol) : (classesOnly || names[it->file] != NoSymbol))
+                continue;
+            if (found[it->file] == NoSymbol && names[it->file] == NoSymbol)
+                matched.push_back(it->file);
+            if (it->isClass)
+                found[it->file] = *sym;
+            else
+                names[it->file] = *sym;
         }
     }
 
-    // Get all needed symbols..
+    // A needed class is preferred over a needed name..
+    for (std::vector<unsigned int>::const_iterator file = matched.begin(); file != matched.end(); ++file)
     {
-        // Which files contain implementation?
-        std::vector<unsigned int> HasImplementation(tokenizer.ShortFileNames.size(), 0);
+        if (found[*file] == NoSymbol)
+            found[*file] = names[*file];
+        providers.insert(*file);
+    }
+}
+//---------------------------------------------------------------------------
 
-        int indentlevel = 0;
-        for (const Token *tok1 = tokenizer.tokens; tok1; tok1 = tok1->next)
+// "file:line" of an #include directive
+static std::string includeLine(const Tokenizer &tokenizer, const Token *tok)
+{
+    std::ostringstream line;
+    line << tokenizer.FullFileNames[tok->FileIndex] << ':' << tok->linenr;
+    return line.str();
+}
+
+// Identify an include in a header for the checked includes. The result
+// depends on whether the included file is a system header in the checked
+// source file, so that is a part of the key.
+static std::string includeKey(const Tokenizer &tokenizer, const IncludeInfo &include,
+                              const std::vector<unsigned int> &SystemHeaders)
+{
+    if (include.hfile < SystemHeaders.size() && SystemHeaders[include.hfile])
+        return includeLine(tokenizer, include.tok) + ":system";
+    return includeLine(tokenizer, include.tok);
+}
+
+/**
+ * Check if the included headers are needed. The includes, the symbols of
+ * the headers and the needed names are collected by visit(), then the
+ * includes are checked by finish().
+ */
+class UnneededInclude : public FileCheck
+{
+public:
+    UnneededInclude(const Tokenizer &tokenizer, const Options *pOptions, std::ostream &errout,
+                    SymbolCache *symbolCache, std::set<std::string> *checkedIncludes,
+                    FixIts *fixIts, std::set<std::string> *unneededIncludes,
+                    HeaderUsage *headerUsage);
+
+    void visit(const Token *tok);
+
+    void finish();
+
+    /**
+     * Don't check the includes, only find the needed symbols that are not
+     * declared in the file that needs them or in the files it includes.
+     * The symbols of the main source file are extracted too.
+     * @param missing "file:symbol" for each missing symbol
+     */
+    void findMissingSymbols(std::set<std::string> *missing);
+
+    /**
+     * Don't check the includes, only extract the symbols of the files that
+     * are not summarized yet. The main file is summarized like a header.
+     */
+    void summarizeOnly();
+
+private:
+    void visitInclude(const Token *tok);
+    void visitExtract(const Token *tok);
+    void visitNeeded(const Token *tok);
+
+    // Get the needed names at a token. Returns the last token that was handled
+    const Token *getNeeded(const Token *tok1);
+
+    // Record the symbols of the included headers that each file uses
+    void recordHeaderUsage(const std::vector<SymbolIds> &needed, const std::vector<unsigned int> &checked);
+
+    // Report a cheaper set of headers that provides the needed symbols of the main source file
+    void checkIncludeSet(const IncludeClosures &closures, const SymbolIndex &symbolIndex,
+                         const SymbolIds &sourceNeeded);
+
+    const Tokenizer &tokenizer;
+    const Options * const pOptions;
+    std::ostream &errout;
+    SymbolCache localCache;
+    SymbolCache * const symbolCache;
+    std::set<std::string> * const checkedIncludes;
+    FixIts * const fixIts;
+    std::set<std::string> * const unneededIncludes;
+    HeaderUsage * const headerUsage;
+    std::set<std::string> *missingSymbols;
+    bool summarizing;
+
+    // Includes of each file
+    std::vector< std::list<IncludeInfo> > includes;
+
+    // System headers are checked differently..
+    std::vector<unsigned int> SystemHeaders;
+
+    // Symbols of the included files. Headers that have been summarized
+    // already are taken from the cache, the others are extracted.
+    const HeaderSymbols noSymbols;
+    HeaderSymbols mainSymbols;
+    std::vector<const HeaderSymbols *> symbols;
+    std::vector<HeaderSymbols *> extract;
+    unsigned int extractIndentlevel;
+    const Token *extractSkip;
+
+    // needed symbol/type names. The names are converted to symbol ids
+    // for the files that are checked.
+    std::vector< std::vector<const Token *> > neededNames;
+
+    // symbol/type names that need at least a forward declaration
+    std::vector< std::vector<const Token *> > needDeclarationNames;
+
+    // Which files contain implementation?
+    std::vector<unsigned int> HasImplementation;
+    int neededIndentlevel;
+    const Token *neededSkip;
+};
+
+UnneededInclude::UnneededInclude(const Tokenizer &t, const Options *options, std::ostream &e,
+                                 SymbolCache *cache, std::set<std::string> *checked,
+                                 FixIts *fixes, std::set<std::string> *unneeded,
+                                 HeaderUsage *usage)
+    : tokenizer(t), pOptions(options), errout(e),
+      symbolCache(cache ? cache : &localCache), checkedIncludes(checked), fixIts(fixes),
+      unneededIncludes(unneeded), headerUsage(usage), missingSymbols(NULL), summarizing(false),
+      includes(t.ShortFileNames.size()),
+      SystemHeaders(t.ShortFileNames.size(), 0),
+      symbols(t.ShortFileNames.size(), &noSymbols),
+      extract(t.ShortFileNames.size(), (HeaderSymbols *)NULL),
+      extractIndentlevel(0), extractSkip(NULL),
+      neededNames(t.ShortFileNames.size()),
+      needDeclarationNames(t.ShortFileNames.size()),
+      HasImplementation(t.ShortFileNames.size(), 0),
+      neededIndentlevel(0), neededSkip(NULL)
+{
+    for (unsigned int i = 1; i < tokenizer.ShortFileNames.size(); ++i)
+    {
+        symbols[i] = symbolCache->find(tokenizer.FileHashes[i]);
+        if (!symbols[i])
+            symbols[i] = extract[i] = &symbolCache->add(tokenizer.FileHashes[i]);
+    }
+}
+
+void UnneededInclude::findMissingSymbols(std::set<std::string> *missing)
+{
+    missingSymbols = missing;
+    symbols[0] = extract[0] = &mainSymbols;
+}
+
+void UnneededInclude::summarizeOnly()
+{
+    summarizing = true;
+    if (!symbolCache->find(tokenizer.FileHashes[0]))
+        symbols[0] = extract[0] = &symbolCache->add(tokenizer.FileHashes[0]);
+}
+
+void UnneededInclude::visit(const Token *tok)
+{
+    if (summarizing)
+    {
+        visitExtract(tok);
+        return;
+    }
+    visitInclude(tok);
+    visitExtract(tok);
+    visitNeeded(tok);
+}
+
+void UnneededInclude::visitInclude(const Token *tok)
+{
+    if (strncmp(tok->str, "#include", 8) != 0)
+        return;
+
+    // Get index of included file:
+    const unsigned int hfile = tokenizer.getFileIndex(tok->next->str);
+    includes[tok->FileIndex].push_back(IncludeInfo(tok, hfile));
+
+    if (hfile < tokenizer.ShortFileNames.size() &&
+        (strcmp(tok->str, "#include<>") == 0 ||
+         (SystemHeaders[tok->FileIndex] && strcmp(tok->str, "#include") == 0)))
+    {
+        SystemHeaders[hfile] = 1;
+    }
+}
+
+void UnneededInclude::visitExtract(const Token *tok)
+{
+    // Skip tokens that have been handled already
+    if (extractSkip)
+    {
+        if (tok == extractSkip)
+            extractSkip = NULL;
+        return;
+    }
+
+    // Don't extract symbols in the main source file or in
+    // headers that are summarized already
+    HeaderSymbols * const sym = extract[tok->FileIndex];
+    if (!sym)
+        return;
+
+    if (strcmp(tok->str, "#include<>") == 0)
+        sym->includes.push_back(std::string("<") + tok->next->str + ">");
+    else if (strncmp(tok->str, "#include", 8) == 0)
+        sym->includes.push_back(tok->next->str);
+
+    if (tok->next && tok->FileIndex != tok->next->FileIndex)
+        extractIndentlevel = 0;
+
+    if (tok->str[0] == '{')
+        extractIndentlevel++;
+
+    else if (extractIndentlevel > 0 && tok->str[0] == '}')
+        extractIndentlevel--;
+
+    if (extractIndentlevel != 0)
+        return;
+
+    const Token *last = extractSymbols(tok, *sym, *symbolCache);
+    if (last != tok)
+        extractSkip = last;
+}
+
+void UnneededInclude::visitNeeded(const Token *tok)
+{
+    // Skip tokens that have been handled already
+    if (neededSkip)
+    {
+        if (tok == neededSkip)
+            neededSkip = NULL;
+        return;
+    }
+
+    const Token *last = getNeeded(tok);
+    if (last != tok)
+        neededSkip = last;
+}
+
+const Token *UnneededInclude::getNeeded(const Token *tok1)
+{
+    if (strncmp(tok1->str, "#include", 8) == 0)
+        return tok1->next;
+
+    if (tok1->next && tok1->FileIndex != tok1->next->FileIndex)
+        neededIndentlevel = 0;
+
+    // implementation begins..
+    else if (neededIndentlevel == 0 && Match(tok1, implementationBegin))
+    {
+        // Go to the "{"
+        while (tok1->str[0] != '{')
+            tok1 = tok1->next;
+        neededIndentlevel = 1;
+        HasImplementation[tok1->FileIndex] = 1;
+    }
+    else if (neededIndentlevel >= 1)
+    {
+        if (tok1->str[0] == '{')
+            ++neededIndentlevel;
+        else if (tok1->str[0] == '}')
+            --neededIndentlevel;
+    }
+
+    if (Match(tok1, baseClass) || Match(tok1, baseClassAccess))
+    {
+        const Token *classname = gettok(tok1, (strcmp(getstr(tok1,2),"{")) ? 2 : 1);
+        neededNames[tok1->FileIndex].push_back(classname);
+    }
+
+    if (neededIndentlevel == 0 && Match(tok1, pointerVariable))
+    {
+        if (Match(gettok(tok1,3), pointerVariableEnd))
         {
-            if (strncmp(tok1->str, "#include", 8) == 0)
+            needDeclarationNames[tok1->FileIndex].push_back(tok1);
+            return gettok(tok1, 2);
+        }
+    }
+
+    if (Match(tok1, structKeyword) || Match(tok1, classKeyword))
+        return tok1;
+
+    if (IsName(tok1->str) && !Match(tok1->next, openBrace))
+        neededNames[tok1->FileIndex].push_back(tok1);
+
+    return tok1;
+}
+
+// What an include brings into the source file: the files that are only
+// included through it, directly or indirectly
+struct IncludeCost
+{
+    IncludeCost() : files(0), bytes(0), tokens(0)
+    { }
+
+    unsigned int files;
+    unsigned long bytes;
+    unsigned long tokens;
+};
+
+static IncludeCost includeCost(const Tokenizer &tokenizer,
+                               const std::vector< std::list<IncludeInfo> > &includes,
+                               const Token *includeTok)
+{
+    // The files that are still included when the include is removed..
+    std::vector<unsigned int> reached(includes.size(), 0);
+    std::vector<unsigned int> todo(1, 0);
+    reached[0] = 1;
+    while (!todo.empty())
+    {
+        const unsigned int file = todo.back();
+        todo.pop_back();
+        for (std::list<IncludeInfo>::const_iterator it = includes[file].begin(); it != includes[file].end(); ++it)
+        {
+            if (it->tok != includeTok && it->hfile < includes.size() && !reached[it->hfile])
             {
-                tok1 = tok1->next;
-                continue;
+                reached[it->hfile] = 1;
+                todo.push_back(it->hfile);
             }
+        }
+    }
 
-            if (tok1->next && tok1->FileIndex != tok1->next->FileIndex)
-                indentlevel = 0;
+    IncludeCost cost;
+    for (unsigned int i = 0; i < includes.size(); ++i)
+    {
+        if (!reached[i])
+        {
+            ++cost.files;
+            cost.bytes += tokenizer.FileSizes[i];
+            cost.tokens += tokenizer.FileTokens[i];
+        }
+    }
+    return cost;
+}
 
-            // implementation begins..
-            else if (indentlevel == 0 && Match(tok1, ") {"))
+// Get the forward declaration of a class in a file, with the namespaces
+// that it is declared in: "namespace A { class B; }". Returns an empty
+// string if the class is not declared in the file or it is a template.
+static std::string forwardDeclaration(const Tokenizer &tokenizer, unsigned int file, const std::string &name)
+{
+    std::vector<const Token *> tokens;
+    for (const Token *tok = tokenizer.tokens; tok; tok = tok->next)
+    {
+        if (tok->FileIndex == file)
+            tokens.push_back(tok);
+    }
+
+    // Namespaces and the indentlevels where they end..
+    std::vector<std::string> namespaces;
+    std::vector<unsigned int> namespaceLevels;
+    unsigned int indentlevel = 0;
+    for (unsigned int i = 0; i < tokens.size(); ++i)
+    {
+        const char *str = tokens[i]->str;
+        if (str[0] == '{' && str[1] == '\0')
+            ++indentlevel;
+        else if (str[0] == '}' && str[1] == '\0' && indentlevel > 0)
+        {
+            --indentlevel;
+            if (!namespaceLevels.empty() && namespaceLevels.back() == indentlevel)
             {
-                // Go to the "{"
-                while (tok1->str[0] != '{')
-                    tok1 = tok1->next;
-                indentlevel = 1;
-                HasImplementation[tok1->FileIndex] = 1;
+                namespaces.pop_back();
+                namespaceLevels.pop_back();
             }
-            else if (indentlevel >= 1)
+        }
+        else if (strcmp(str, "namespace") == 0 && i + 2 < tokens.size() &&
+                 IsName(tokens[i+1]->str) && strcmp(tokens[i+2]->str, "{") == 0)
+        {
+            namespaces.push_back(tokens[i+1]->str);
+            namespaceLevels.push_back(indentlevel);
+            ++indentlevel;
+            i += 2;
+        }
+        else if ((strcmp(str, "class") == 0 || strcmp(str, "struct") == 0) &&
+                 indentlevel == namespaces.size() &&
+                 i + 2 < tokens.size() && name == tokens[i+1]->str &&
+                 strchr("{:;", tokens[i+2]->str[0]) && tokens[i+2]->str[1] == '\0')
+        {
+            if (i > 0 && strcmp(tokens[i-1]->str, ">") == 0)
+                return "";
+
+            std::string declaration(std::string(str) + " " + name + ";");
+            for (unsigned int k = namespaces.size(); k > 0; --k)
+                declaration = "namespace " + namespaces[k-1] + " { " + declaration + " }";
+            return declaration;
+        }
+    }
+    return "";
+}
+
+// Get the forward declarations of the classes that are declared in the
+// included files. Returns false if some class can't be forward declared.
+static bool getForwardDeclarations(const Tokenizer &tokenizer, const SymbolIndex &symbolIndex,
+                                   const SymbolCache &symbolCache, const SymbolIds &needDeclaration,
+                                   const FileSet &included, const std::vector<unsigned int> &SystemHeaders,
+                                   std::vector<std::string> &declarations)
+{
+    for (SymbolIds::const_iterator sym = needDeclaration.begin(); sym != needDeclaration.end(); ++sym)
+    {
+        std::vector<SymbolId> found;
+        FileSet declarers(included.size());
+        symbolIndex.find(SymbolIds(1, *sym), true, found, declarers);
+        const unsigned int file = included.nextCommon(declarers, 0);
+        if (file >= included.size())
+            continue;
+        if (SystemHeaders[file])
+            return false;
+
+        const std::string declaration(forwardDeclaration(tokenizer, file, symbolCache.getName(*sym)));
+        if (declaration.empty())
+            return false;
+        declarations.push_back(declaration);
+    }
+    return !declarations.empty();
+}
+
+// Annotate a message with the cost of the include, for --include-cost
+static void reportCost(std::ostream &errmsg, const IncludeCost &cost)
+{
+    errmsg << " (cost: " << cost.files << " files, "
+           << cost.bytes << " bytes, "
+           << cost.tokens << " tokens)";
+}
+
+// Tokens of the files in a set, the main source file is not counted
+static unsigned long setTokens(const Tokenizer &tokenizer, const FileSet &files)
+{
+    unsigned long tokens = 0;
+    for (unsigned int file = files.next(1); file < files.size(); file = files.next(file + 1))
+        tokens += tokenizer.FileTokens[file];
+    return tokens;
+}
+
+// Candidates up to this count are solved exactly, more are solved greedily
+static const unsigned int exactIncludeSetLimit = 12;
+
+/**
+ * Find the cheapest set of headers that provides the needed symbols: the
+ * files that the headers include directly or indirectly have the fewest
+ * tokens. Small cases are solved exactly, otherwise the header that costs
+ * the fewest new tokens per new symbol is chosen until all symbols are
+ * provided and then the headers that are not needed anymore are dropped.
+ * @param tokenizer tokenized source file
+ * @param closures the files that each file includes
+ * @param candidates the headers that can be included
+ * @param providers for each needed symbol the files that declare it
+ * @return the chosen headers
+ */
+static std::vector<unsigned int> cheapestIncludes(const Tokenizer &tokenizer, const IncludeClosures &closures,
+                                                  const std::vector<unsigned int> &candidates,
+                                                  const std::vector<FileSet> &providers)
+{
+    // The symbols that each candidate provides..
+    std::vector< std::vector<bool> > provides(candidates.size(), std::vector<bool>(providers.size(), false));
+    for (unsigned int c = 0; c < candidates.size(); ++c)
+    {
+        const FileSet &closure = closures.get(candidates[c]);
+        for (unsigned int k = 0; k < providers.size(); ++k)
+            provides[c][k] = bool(closure.nextCommon(providers[k], 0) < closure.size());
+    }
+
+    std::vector<unsigned int> chosen;
+    if (candidates.size() <= exactIncludeSetLimit)
+    {
+        unsigned long bestTokens = 0;
+        for (unsigned int subset = 1; subset < (1U << candidates.size()); ++subset)
+        {
+            FileSet files(tokenizer.ShortFileNames.size());
+            std::vector<bool> provided(providers.size(), false);
+            std::vector<unsigned int> headers;
+            for (unsigned int c = 0; c < candidates.size(); ++c)
             {
-                if (tok1->str[0] == '{')
-                    ++indentlevel;
-                else if (tok1->str[0] == '}')
-                    --indentlevel;
+                if (!((subset >> c) & 1U))
+                    continue;
+                headers.push_back(candidates[c]);
+                files.merge(closures.get(candidates[c]));
+                for (unsigned int k = 0; k < providers.size(); ++k)
+                    provided[k] = provided[k] || provides[c][k];
             }
+            if (std::find(provided.begin(), provided.end(), false) != provided.end())
+                continue;
 
-            if (Match(tok1, ": %var% {") || Match(tok1, ": %type% %var% {"))
+            const unsigned long tokens = setTokens(tokenizer, files);
+            if (chosen.empty() || tokens < bestTokens || (tokens == bestTokens && headers.size() < chosen.size()))
             {
-                const std::string classname(getstr(tok1, (strcmp(getstr(tok1,2),"{")) ? 2 : 1));
-                needed[tok1->FileIndex].insert(classname);
+                chosen = headers;
+                bestTokens = tokens;
             }
+        }
+        return chosen;
+    }
 
-            if (indentlevel == 0 && Match(tok1, "%type% * %var%"))
+    // Greedy: the fewest new tokens per new symbol..
+    FileSet files(tokenizer.ShortFileNames.size());
+    std::vector<bool> provided(providers.size(), false);
+    std::vector<unsigned int> chosenIndexes;
+    for (;;)
+    {
+        unsigned int best = candidates.size();
+        unsigned long bestTokens = 0;
+        unsigned int bestSymbols = 0;
+        for (unsigned int c = 0; c < candidates.size(); ++c)
+        {
+            unsigned int symbols = 0;
+            for (unsigned int k = 0; k < providers.size(); ++k)
+                symbols += (!provided[k] && provides[c][k]) ? 1 : 0;
+            if (symbols == 0)
+                continue;
+
+            FileSet added(files);
+            added.merge(closures.get(candidates[c]));
+            const unsigned long tokens = setTokens(tokenizer, added) - setTokens(tokenizer, files);
+
+            // tokens / symbols < bestTokens / bestSymbols
+            if (best == candidates.size() || tokens * bestSymbols < bestTokens * symbols)
             {
-                if (Match(gettok(tok1,3), "[,;()[]"))
-                {
-                    needDeclaration[tok1->FileIndex].insert(tok1->str);
-                    tok1 = gettok(tok1, 2);
-                    continue;
-                }
+                best = c;
+                bestTokens = tokens;
+                bestSymbols = symbols;
             }
+        }
+        if (best == candidates.size())
+            break;
 
-            if (Match(tok1, "struct") || Match(tok1, "class"))
-            {
+        chosenIndexes.push_back(best);
+        files.merge(closures.get(candidates[best]));
+        for (unsigned int k = 0; k < providers.size(); ++k)
+            provided[k] = provided[k] || provides[best][k];
+    }
+
+    // Drop the headers whose symbols the other chosen headers provide..
+    for (unsigned int i = chosenIndexes.size(); i > 0; --i)
+    {
+        bool dropped = true;
+        for (unsigned int k = 0; k < providers.size() && dropped; ++k)
+        {
+            if (!provides[chosenIndexes[i-1]][k])
                 continue;
-            }
+            bool other = false;
+            for (unsigned int j = 0; j < chosenIndexes.size() && !other; ++j)
+                other = bool(j != i - 1 && provides[chosenIndexes[j]][k]);
+            dropped = other;
+        }
+        if (dropped)
+            chosenIndexes.erase(chosenIndexes.begin() + (i - 1));
+    }
+
+    for (unsigned int i = 0; i < chosenIndexes.size(); ++i)
+        chosen.push_back(candidates[chosenIndexes[i]]);
+    std::sort(chosen.begin(), chosen.end());
+    return chosen;
+}
 
-            if (IsName(tok1->str) && !Match(tok1->next, "{"))
-                needed[tok1->FileIndex].insert(tok1->str);
+void UnneededInclude::finish()
+{
+    // A header is needed if:
+    // * It contains some needed class declaration
+    // * It contains some needed function declaration
+    // * It contains some needed constant value
+    // * It contains some needed variable
+    // * It contains some needed enum
+
+    for (unsigned int i = 0; i < extract.size(); ++i)
+    {
+        if (extract[i])
+        {
+            sortSymbols(extract[i]->classes);
+            sortSymbols(extract[i]->names);
+            sortSymbols(extract[i]->declarations);
         }
+    }
+    if (summarizing)
+        return;
 
-        // Move needDeclaration symbols to needed for all files that has
-        // implementation..
-        for (unsigned int i = 0; i < HasImplementation.size(); ++i)
+    // Reverse include index: the #include directives that include each file..
+    std::vector< std::vector<const Token *> > includedBy(tokenizer.ShortFileNames.size());
+    for (unsigned int i = 0; i < tokenizer.ShortFileNames.size(); ++i)
+    {
+        for (std::list<IncludeInfo>::const_iterator it = includes[i].begin(); it != includes[i].end(); ++it)
         {
-            if (HasImplementation[i])
+            if (it->hfile < tokenizer.ShortFileNames.size())
+                includedBy[it->hfile].push_back(it->tok);
+        }
+    }
+
+    // Includes in headers that have been checked for another source file
+    // are not checked again. The main source file is always checked.
+    std::vector< std::set<const Token *> > checkedTokens(tokenizer.ShortFileNames.size());
+    std::vector<unsigned int> checked(tokenizer.ShortFileNames.size(), 0);
+    if (checkedIncludes)
+    {
+        for (unsigned int i = 1; i < tokenizer.ShortFileNames.size(); ++i)
+        {
+            checked[i] = 1;
+            for (std::list<IncludeInfo>::const_iterator it = includes[i].begin(); it != includes[i].end(); ++it)
             {
-                needed[i].insert(needDeclaration[i].begin(), needDeclaration[i].end());
+                if (checkedIncludes->count(includeKey(tokenizer, *it, SystemHeaders)))
+                    checkedTokens[i].insert(it->tok);
+                else if (it->hfile < tokenizer.ShortFileNames.size())
+                    checked[i] = 0;
             }
         }
     }
 
-    // Remove keywords..
+    // Get the needed symbols of the files that are checked..
+    std::vector<SymbolIds> needed(tokenizer.ShortFileNames.size(), SymbolIds());
+    std::vector<SymbolIds> needDeclaration(tokenizer.ShortFileNames.size(), SymbolIds());
     for (unsigned int i = 0; i < tokenizer.ShortFileNames.size(); ++i)
+    {
+        if (checked[i])
+            continue;
+
+        for (unsigned int k = 0; k < neededNames[i].size(); ++k)
+            needed[i].push_back(symbolCache->getId(neededNames[i][k]->str));
+        for (unsigned int k = 0; k < needDeclarationNames[i].size(); ++k)
+            needDeclaration[i].push_back(symbolCache->getId(needDeclarationNames[i][k]->str));
+
+        // Move needDeclaration symbols to needed for all files that has
+        // implementation..
+        if (HasImplementation[i])
+            needed[i].insert(needed[i].end(), needDeclaration[i].begin(), needDeclaration[i].end());
+    }
+
+    // The symbols that the main source file needs itself, without the
+    // forward declarations of its headers
+    SymbolIds sourceNeeded(needed[0]);
+
+    if (headerUsage && !missingSymbols)
+        recordHeaderUsage(needed, checked);
+
+    // Forward declarations: the type name is probably needed in any file
+    // that includes the header. Missing symbols are only the names that
+    // are used.
+    for (unsigned int hfile = 1; hfile < tokenizer.ShortFileNames.size() && !missingSymbols; ++hfile)
+    {
+        const SymbolIds &declarations = symbols[hfile]->declarations;
+        if (declarations.empty())
+            continue;
+
+        for (std::vector<const Token *>::const_iterator it = includedBy[hfile].begin(); it != includedBy[hfile].end(); ++it)
+        {
+            const unsigned int i = (*it)->FileIndex;
+            if (i != hfile && !checked[i])
+                needed[i].insert(needed[i].end(), declarations.begin(), declarations.end());
+        }
+    }
+
+    // Remove keywords..
     {
         const char *keywords[] = { "defined", // preprocessor
                                    "void",
@@ -371,13 +1296,67 @@ void WarningIncludeHeader(const Tokenizer &tokenizer, const Options *pOptions,
                                    NULL
                                  };
 
+        SymbolIds keywordIds;
         for (unsigned int k = 0; keywords[k]; ++k)
+            keywordIds.push_back(symbolCache->getId(keywords[k]));
+        sortSymbols(keywordIds);
+
+        for (unsigned int i = 0; i < tokenizer.ShortFileNames.size(); ++i)
         {
-            needed[i].erase(keywords[k]);
-            needDeclaration[i].erase(keywords[k]);
+            sortSymbols(needed[i]);
+            sortSymbols(needDeclaration[i]);
+            removeSymbols(needed[i], keywordIds);
+            removeSymbols(needDeclaration[i], keywordIds);
+        }
+        sortSymbols(sourceNeeded);
+        removeSymbols(sourceNeeded, keywordIds);
+    }
+
+    // Files included directly or indirectly by each file..
+    const IncludeClosures closures(includes);
+
+    // The headers that declare each symbol..
+    const SymbolIndex symbolIndex(symbols);
+
+    // Find the missing symbols instead of checking the includes..
+    if (missingSymbols)
+    {
+        for (unsigned int fileIndex = 0; fileIndex < tokenizer.ShortFileNames.size(); ++fileIndex)
+        {
+            if (SystemHeaders[fileIndex])
+                continue;
+
+            // The symbols in needDeclaration are in needed too for files
+            // with implementation, but a forward declaration is enough
+            SymbolIds used(needed[fileIndex]);
+            used.insert(used.end(), needDeclaration[fileIndex].begin(), needDeclaration[fileIndex].end());
+            sortSymbols(used);
+
+            const FileSet &included = closures.get(fileIndex);
+            for (unsigned int k = 0; k < used.size(); ++k)
+            {
+                const SymbolId sym = used[k];
+                const bool declaration = hasSymbol(needDeclaration[fileIndex], sym);
+
+                std::vector<SymbolId> found;
+                FileSet providers(tokenizer.ShortFileNames.size());
+                symbolIndex.find(SymbolIds(1, sym), declaration, found, providers);
+                bool declared = bool(included.nextCommon(providers, 0) < included.size());
+
+                // A forward declaration is enough..
+                for (unsigned int file = included.next(0); declaration && !declared && file < included.size(); file = included.next(file + 1))
+                    declared = hasSymbol(symbols[file]->declarations, sym);
+
+                if (!declared)
+                    missingSymbols->insert(tokenizer.FullFileNames[fileIndex] + ":" + symbolCache->getName(sym));
+            }
         }
+        return;
     }
 
+    // Report includes that are included through other needed includes too?
+    const bool checkRedundant = bool(pOptions->EnabledChecks.count("redundant") > 0);
+
     // Check if there are redundant includes..
     for (unsigned int fileIndex = 0; fileIndex < tokenizer.ShortFileNames.size(); ++fileIndex)
     {
@@ -385,6 +1364,23 @@ void WarningIncludeHeader(const Tokenizer &tokenizer, const Options *pOptions,
         if (SystemHeaders[fileIndex])
             continue;
 
+        // Has the header been checked already?
+        if (checked[fileIndex])
+            continue;
+
+        // The headers that declare needed symbols..
+        std::vector<SymbolId> providedSymbol;
+        FileSet providers(tokenizer.ShortFileNames.size());
+        symbolIndex.find(needed[fileIndex], false, providedSymbol, providers);
+
+        // The headers that declare classes that need a forward declaration..
+        std::vector<SymbolId> declaredClass;
+        FileSet declarers(tokenizer.ShortFileNames.size());
+        symbolIndex.find(needDeclaration[fileIndex], true, declaredClass, declarers);
+
+        // The includes that are needed directly..
+        std::vector<const IncludeInfo *> neededIncludes;
+
         // Check if each include is needed..
         for (std::list<IncludeInfo>::const_iterator include = includes[fileIndex].begin(); include != includes[fileIndex].end(); ++include)
         {
@@ -392,30 +1388,33 @@ void WarningIncludeHeader(const Tokenizer &tokenizer, const Options *pOptions,
             if (include->hfile >= tokenizer.ShortFileNames.size())
                 continue;
 
+            // Has the include been checked already?
+            if (checkedTokens[fileIndex].count(include->tok))
+                continue;
+            if (checkedIncludes && fileIndex > 0)
+                checkedIncludes->insert(includeKey(tokenizer, *include, SystemHeaders));
+
             if (pOptions->Progress)
             {
                 std::cout << "progress: file " << tokenizer.ShortFileNames[fileIndex] << " checking include " << tokenizer.ShortFileNames[include->hfile] << std::endl;
             }
 
             // Get all includes
-            std::set<unsigned int> AllIncludes;
-            bool notfound = false;
-            AllIncludes.insert(include->hfile);
-            if (SystemHeaders[include->hfile])
-                getincludes(includes, include->hfile, AllIncludes, notfound);
+            const FileSet &AllIncludes = closures.get(include->hfile);
+            const bool notfound = closures.notFound(include->hfile);
 
-            // match symbols: needed
+            // match symbols: needed. System headers are checked together
+            // with the headers they include.
             bool Needed(false);
-            for (std::set<unsigned int>::const_iterator it = AllIncludes.begin(); it != AllIncludes.end(); ++it)
+            const unsigned int provider = SystemHeaders[include->hfile] ?
+                                          AllIncludes.nextCommon(providers, 0) :
+                                          (providers.contains(include->hfile) ? include->hfile : providers.size());
+            if (provider < providers.size())
             {
-                const std::string sym = matchSymbols(needed[fileIndex], classes[*it], names[*it]);
-                if (!sym.empty())
-                {
-                    if (pOptions->Progress)
-                        std::cout << "progress: needed symbol '" << sym << "'" << std::endl;
-                    Needed = true;
-                    break;
-                }
+                if (pOptions->Progress)
+                    std::cout << "progress: needed symbol '" << symbolCache->getName(providedSymbol[provider]) << "'" << std::endl;
+                Needed = true;
+                neededIncludes.push_back(&*include);
             }
 
             // Check if local header is needed indirectly..
@@ -423,19 +1422,14 @@ void WarningIncludeHeader(const Tokenizer &tokenizer, const Options *pOptions,
             {
                 std::string needed_header;
 
-                getincludes(includes, include->hfile, AllIncludes, notfound);
-                for (std::set<unsigned int>::const_iterator it = AllIncludes.begin(); it != AllIncludes.end(); ++it)
+                const unsigned int it = AllIncludes.nextCommon(providers, 0);
+                if (it < AllIncludes.size())
                 {
-                    const std::string sym = matchSymbols(needed[fileIndex], classes[*it], names[*it]);
-                    if (!sym.empty())
-                    {
-                        needed_header = tokenizer.ShortFileNames[*it];
+                    needed_header = tokenizer.ShortFileNames[it];
 
-                        if (pOptions->Progress)
-                            std::cout << "progress: needed symbol '" << sym << "'" << std::endl;
-                        Needed = true;
-                        break;
-                    }
+                    if (pOptions->Progress)
+                        std::cout << "progress: needed symbol '" << symbolCache->getName(providedSymbol[it]) << "'" << std::endl;
+                    Needed = true;
                 }
 
                 if (Needed)
@@ -448,6 +1442,8 @@ void WarningIncludeHeader(const Tokenizer &tokenizer, const Options *pOptions,
                            << "'. If it is included by intention use '--skip "
                            << include->tok->next->str
                            << "' to remove false positives.";
+                    if (pOptions->IncludeCost)
+                        reportCost(errmsg, includeCost(tokenizer, includes, include->tok));
                     ReportErr(tokenizer, pOptions->outputFormat, include->tok, "HeaderNotNeeded", errmsg.str(), errout);
                 }
             }
@@ -456,31 +1452,327 @@ void WarningIncludeHeader(const Tokenizer &tokenizer, const Options *pOptions,
             {
                 if (!notfound)
                 {
-                    bool NeedDeclaration(false);
-                    for (std::set<unsigned int>::const_iterator it = AllIncludes.begin(); it != AllIncludes.end(); ++it)
+                    const bool NeedDeclaration = bool(AllIncludes.nextCommon(declarers, 0) < AllIncludes.size());
+
+                    // The include can be removed or replaced by forward declarations..
+                    if (!NeedDeclaration && fixIts)
+                        fixIts->replaceLine(tokenizer.FullFileNames[fileIndex], include->tok->linenr,
+                                            include->tok->next->str, std::vector<std::string>());
+                    else if (NeedDeclaration && fixIts && !SystemHeaders[include->hfile])
                     {
-                        std::set<std::string> empty;
-                        const std::string sym = matchSymbols(needDeclaration[fileIndex], classes[*it], empty);
-                        if (!sym.empty())
-                        {
-                            NeedDeclaration = true;
-                            break;
-                        }
+                        std::vector<std::string> declarations;
+                        if (getForwardDeclarations(tokenizer, symbolIndex, *symbolCache, needDeclaration[fileIndex], AllIncludes, SystemHeaders, declarations))
+                            fixIts->replaceLine(tokenizer.FullFileNames[fileIndex], include->tok->linenr,
+                                                include->tok->next->str, declarations);
                     }
 
                     std::ostringstream errmsg;
                     errmsg << "The included header '" << include->tok->next->str << "' is not needed";
                     if (NeedDeclaration)
                         errmsg << " (but forward declaration is needed)";
+                    if (pOptions->IncludeCost)
+                        reportCost(errmsg, includeCost(tokenizer, includes, include->tok));
 
                     ReportErr(tokenizer, pOptions->outputFormat, include->tok, "HeaderNotNeeded", errmsg.str(), errout);
+                    if (unneededIncludes)
+                        unneededIncludes->insert(includeLine(tokenizer, include->tok));
                 }
                 else if (pOptions->Progress)
                     std::cout << "progress: bail out (header not found)" << std::endl;
             }
         }
+
+        // Needed includes that are included by other needed includes..
+        for (unsigned int i = 0; checkRedundant && i < neededIncludes.size(); ++i)
+        {
+            const IncludeInfo &include = *neededIncludes[i];
+            for (unsigned int k = 0; k < neededIncludes.size(); ++k)
+            {
+                const IncludeInfo &other = *neededIncludes[k];
+                if (other.hfile == include.hfile || other.hfile == fileIndex || SystemHeaders[other.hfile] ||
+                    !closures.get(other.hfile).contains(include.hfile))
+                    continue;
+
+                // Of headers that include each other the first include is kept
+                if (closures.get(include.hfile).contains(other.hfile) && k > i)
+                    continue;
+
+                std::ostringstream errmsg;
+                errmsg << "The included header '" << include.tok->next->str
+                       << "' is redundant via '" << other.tok->next->str << "'";
+                ReportErr(tokenizer, pOptions->outputFormat, include.tok, "HeaderRedundant", errmsg.str(), errout);
+                break;
+            }
+        }
     }
+
+    if (pOptions->EnabledChecks.count("includeset") && !checked[0] && !SystemHeaders[0])
+        checkIncludeSet(closures, symbolIndex, sourceNeeded);
 }
+
+void UnneededInclude::recordHeaderUsage(const std::vector<SymbolIds> &needed, const std::vector<unsigned int> &checked)
+{
+    const unsigned int files = tokenizer.ShortFileNames.size();
+    for (unsigned int file = 0; file < files; ++file)
+    {
+        if (checked[file] || SystemHeaders[file] || includes[file].empty())
+            continue;
+
+        SymbolIds used(needed[file]);
+        sortSymbols(used);
+
+        for (std::list<IncludeInfo>::const_iterator it = includes[file].begin(); it != includes[file].end(); ++it)
+        {
+            if (it->hfile >= files || it->hfile == file || SystemHeaders[it->hfile])
+                continue;
+
+            const HeaderSymbols &header = *symbols[it->hfile];
+            std::vector<std::string> declared;
+            std::vector<std::string> usedSymbols;
+            const SymbolIds * const lists[] = { &header.classes, &header.names };
+            for (unsigned int list = 0; list < 2; ++list)
+            {
+                for (unsigned int k = 0; k < lists[list]->size(); ++k)
+                {
+                    const SymbolId sym = (*lists[list])[k];
+                    declared.push_back(symbolCache->getName(sym));
+                    if (hasSymbol(used, sym))
+                        usedSymbols.push_back(symbolCache->getName(sym));
+                }
+            }
+
+            headerUsage->addHeader(tokenizer.FullFileNames[it->hfile], tokenizer.FileTokens[it->hfile], declared);
+            headerUsage->addUsage(tokenizer.FullFileNames[it->hfile], tokenizer.FullFileNames[file], usedSymbols);
+        }
+    }
+}
+
+// Name of a header in a message, "<x.h>" for system headers
+static std::string headerName(const Tokenizer &tokenizer, unsigned int file, bool SystemHeader)
+{
+    return SystemHeader ? ("<" + tokenizer.ShortFileNames[file] + ">") : tokenizer.ShortFileNames[file];
+}
+
+// The name that the source file can include a header with: the path
+// relative to the directory of the source file or an include path. The
+// first file that the name finds must be the header. The shortest name is
+// used, empty if there is no such name.
+static std::string includeName(const Tokenizer &tokenizer, unsigned int file)
+{
+    const std::string &source = tokenizer.FullFileNames[0];
+    std::vector<std::string> paths(1, source.substr(0, source.find_last_of("\\/") + 1));
+    for (unsigned int i = 0; i < tokenizer.IncludePaths.size(); ++i)
+    {
+        std::string path(tokenizer.IncludePaths[i]);
+        if (!path.empty() && path[path.size() - 1] != '\\' && path[path.size() - 1] != '/')
+            path += '/';
+        paths.push_back(path);
+    }
+
+    const std::string &fullName = tokenizer.FullFileNames[file];
+    std::string shortest;
+    for (unsigned int i = 0; i < paths.size(); ++i)
+    {
+        if (fullName.size() <= paths[i].size() || fullName.compare(0, paths[i].size(), paths[i]) != 0)
+            continue;
+        const std::string name(fullName.substr(paths[i].size()));
+        for (unsigned int k = 0; k < paths.size(); ++k)
+        {
+            if (paths[k] + name == fullName)
+            {
+                if (shortest.empty() || name.size() < shortest.size())
+                    shortest = name;
+                break;
+            }
+            if (std::ifstream((paths[k] + name).c_str()).is_open())
+                break;
+        }
+    }
+    return shortest;
+}
+
+void UnneededInclude::checkIncludeSet(const IncludeClosures &closures, const SymbolIndex &symbolIndex,
+                                      const SymbolIds &sourceNeeded)
+{
+    const unsigned int files = tokenizer.ShortFileNames.size();
+
+    // The headers that can be included: the local headers and the system
+    // headers that local files include..
+    std::vector<unsigned int> includable(files, 0);
+    std::vector<std::string> names(files);
+    for (unsigned int file = 0; file < files; ++file)
+    {
+        if (SystemHeaders[file])
+            continue;
+        if (file > 0)
+            includable[file] = 1;
+        for (std::list<IncludeInfo>::const_iterator it = includes[file].begin(); it != includes[file].end(); ++it)
+        {
+            if (it->hfile < files && it->hfile > 0)
+                includable[it->hfile] = 1;
+        }
+    }
+
+    // ..that the source file can include by some name. The headers that it
+    // includes already have a name..
+    for (std::list<IncludeInfo>::const_iterator it = includes[0].begin(); it != includes[0].end(); ++it)
+    {
+        if (it->hfile < files && it->hfile > 0)
+            names[it->hfile] = it->tok->next->str;
+    }
+    for (unsigned int file = 1; file < files; ++file)
+    {
+        if (includable[file] && names[file].empty())
+            names[file] = includeName(tokenizer, file);
+        if (names[file].empty())
+            includable[file] = 0;
+    }
+
+    // The needed symbols that the headers provide..
+    std::vector<FileSet> providers;
+    for (unsigned int k = 0; k < sourceNeeded.size(); ++k)
+    {
+        std::vector<SymbolId> found;
+        FileSet declarers(files);
+        symbolIndex.find(SymbolIds(1, sourceNeeded[k]), false, found, declarers);
+        if (declarers.next(1) < files)
+            providers.push_back(declarers);
+    }
+    if (providers.empty())
+        return;
+
+    // The headers that provide some needed symbol..
+    std::vector<unsigned int> candidates;
+    for (unsigned int file = 1; file < files; ++file)
+    {
+        if (!includable[file])
+            continue;
+        const FileSet &closure = closures.get(file);
+        for (unsigned int k = 0; k < providers.size(); ++k)
+        {
+            if (closure.nextCommon(providers[k], 0) < closure.size())
+            {
+                candidates.push_back(file);
+                break;
+            }
+        }
+    }
+
+    const std::vector<unsigned int> chosen(cheapestIncludes(tokenizer, closures, candidates, providers));
+
+    // The current includes and the files they bring in..
+    FileSet current(files);
+    std::vector<const IncludeInfo *> removed;
+    for (std::list<IncludeInfo>::const_iterator it = includes[0].begin(); it != includes[0].end(); ++it)
+    {
+        if (it->hfile >= files)
+            continue;
+        current.merge(closures.get(it->hfile));
+        if (!std::binary_search(chosen.begin(), chosen.end(), it->hfile))
+            removed.push_back(&*it);
+    }
+
+    // Only report sets that include new headers. Removing includes is
+    // reported by the include check..
+    std::vector<unsigned int> added;
+    for (unsigned int i = 0; i < chosen.size(); ++i)
+    {
+        bool included = false;
+        for (std::list<IncludeInfo>::const_iterator it = includes[0].begin(); it != includes[0].end() && !included; ++it)
+            included = bool(it->hfile == chosen[i]);
+        if (!included)
+            added.push_back(chosen[i]);
+    }
+
+    FileSet suggested(files);
+    for (unsigned int i = 0; i < chosen.size(); ++i)
+        suggested.merge(closures.get(chosen[i]));
+    const unsigned long currentTokens = setTokens(tokenizer, current);
+    const unsigned long suggestedTokens = setTokens(tokenizer, suggested);
+    if (added.empty() || removed.empty() || suggestedTokens >= currentTokens)
+        return;
+
+    std::ostringstream errmsg;
+    errmsg << "Cheaper includes provide the needed symbols: include ";
+    for (unsigned int i = 0; i < added.size(); ++i)
+        errmsg << (i == 0 ? "'" : ", '") << (SystemHeaders[added[i]] ? "<" + names[added[i]] + ">" : names[added[i]]) << "'";
+    errmsg << " instead of ";
+    for (unsigned int i = 0; i < removed.size(); ++i)
+        errmsg << (i == 0 ? "'" : ", '") << headerName(tokenizer, removed[i]->hfile, SystemHeaders[removed[i]->hfile]) << "'";
+    errmsg << " (saves " << (currentTokens - suggestedTokens) << " of " << currentTokens << " tokens)";
+    ReportErr(tokenizer, pOptions->outputFormat, removed[0]->tok, "CheaperIncludes", errmsg.str(), errout);
+}
+//---------------------------------------------------------------------------
+
+void WarningIncludeHeader(const Tokenizer &tokenizer, const Options *pOptions,
+                          std::ostream &errout, SymbolCache *symbolCache,
+                          std::set<std::string> *checkedIncludes, FixIts *fixIts)
+{
+    UnneededInclude check(tokenizer, pOptions, errout, symbolCache, checkedIncludes, fixIts, NULL, NULL);
+    runCheck(tokenizer, check);
+}
+
+std::set<std::string> MissingSymbols(const Tokenizer &tokenizer, SymbolCache *symbolCache)
+{
+    Options options;
+    options.Progress = false;
+    std::ostringstream errout;
+
+    std::set<std::string> missing;
+    UnneededInclude check(tokenizer, &options, errout, symbolCache, NULL, NULL, NULL, NULL);
+    check.findMissingSymbols(&missing);
+    runCheck(tokenizer, check);
+    return missing;
+}
+
+void SummarizeHeaders(const Tokenizer &tokenizer, const std::vector<std::string> &includePaths,
+                      const std::set<std::string> &skipIncludes, const Options *pOptions,
+                      SymbolCache *symbolCache)
+{
+    // Missing headers are tokenized differently when they are ignored. They
+    // are reported when the source file is checked.
+    Options options;
+    options.Progress = false;
+    options.IgnoreMissingIncludeFile = pOptions->IgnoreMissingIncludeFile;
+    std::ostringstream errout;
+
+    // The headers find the files in the directory of the source file too
+    std::vector<std::string> headerPaths;
+    const std::string &source = tokenizer.FullFileNames.empty() ? std::string() : tokenizer.FullFileNames[0];
+    if (source.find_first_of("\\/") != std::string::npos)
+        headerPaths.push_back(source.substr(0, 1 + source.find_last_of("\\/")));
+    headerPaths.insert(headerPaths.end(), includePaths.begin(), includePaths.end());
+
+    SuppressErrors(true);
+
+    for (unsigned int i = 1; i < tokenizer.FullFileNames.size(); ++i)
+    {
+        if (symbolCache->find(tokenizer.FileHashes[i]))
+            continue;
+
+        Tokenizer header;
+        header.tokenize(tokenizer.FullFileNames[i].c_str(), headerPaths, skipIncludes, &options, errout);
+        if (header.FullFileNames.empty())
+            continue;
+
+        UnneededInclude check(header, &options, errout, symbolCache, NULL, NULL, NULL, NULL);
+        check.summarizeOnly();
+        runCheck(header, check);
+    }
+    SuppressErrors(false);
+}
+
+static FileCheck *createUnneededInclude(const Tokenizer &tokenizer, const CheckContext &context, std::ostream &errout)
+{
+    return new UnneededInclude(tokenizer, context.pOptions, errout, context.symbolCache, context.checkedIncludes,
+                               context.fixIts, context.unneededIncludes, context.headerUsage);
+}
+
+static const Check unneededInclude("include", true, createUnneededInclude);
+
+// Redundant includes and cheaper sets of includes are reported by the include check
+static const Check redundantInclude("redundant", false, NULL);
+static const Check cheaperIncludes("includeset", false, NULL);
 //---------------------------------------------------------------------------
 
 
@@ -24,12 +24,59 @@
 
 #include "tokenize.h"
 #include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+class FixIts;
+class SymbolCache;
 
 void WarningHeaderWithImplementation(const Tokenizer &tokenizer,
                                      const Options *pOptions, std::ostream &errout);
 
+/**
+ * Check if the included headers are needed
+ * @param tokenizer tokenized source file
+ * @param pOptions options
+ * @param errout error stream
+ * @param symbolCache symbols of headers, shared between the checked
+ *                    source files. If NULL the symbols are only cached
+ *                    for this source file.
+ * @param checkedIncludes includes in headers that have been checked. The
+ *                    includes in the set are not checked again, the
+ *                    includes that are checked now are added. If NULL
+ *                    all includes are checked.
+ * @param fixIts if not NULL, the unneeded includes are removed here or
+ *                    replaced by the forward declarations that are needed
+ */
 void WarningIncludeHeader(const Tokenizer &tokenizer, const Options *pOptions,
-                          std::ostream &errout);
+                          std::ostream &errout, SymbolCache *symbolCache = NULL,
+                          std::set<std::string> *checkedIncludes = NULL,
+                          FixIts *fixIts = NULL);
+
+/**
+ * Get the needed symbols that are not declared in the file that needs
+ * them or in the files that it includes. Includes can be removed safely
+ * if no symbols become missing.
+ * @param tokenizer tokenized source file
+ * @param symbolCache symbols of headers
+ * @return "file:symbol" for each missing symbol
+ */
+std::set<std::string> MissingSymbols(const Tokenizer &tokenizer, SymbolCache *symbolCache);
+
+/**
+ * Extract the symbols of the headers that a source file includes and that
+ * are not in the cache yet. Each header is tokenized without the source
+ * file, so the source file only needs its includes to be resolved.
+ * @param tokenizer source file
+ * @param includePaths search paths for the headers
+ * @param skipIncludes skip #include that match
+ * @param pOptions options
+ * @param symbolCache the extracted symbols are added here
+ */
+void SummarizeHeaders(const Tokenizer &tokenizer, const std::vector<std::string> &includePaths,
+                      const std::set<std::string> &skipIncludes, const Options *pOptions,
+                      SymbolCache *symbolCache);
 
 //---------------------------------------------------------------------------
 #endif
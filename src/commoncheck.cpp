@@ -53,8 +53,14 @@ bool SameFileName(const char fname1[], const char fname2[])
 
 std::set<std::string> ErrorList;
 
+static std::vector<std::string> *RecordedErrors = NULL;
+static bool SuppressedErrors = false;
+
 void ReportErr(OutputFormat of, const std::string &file, const int line, const std::string &id, const std::string &errmsg, std::ostream &errout)
 {
+    if (SuppressedErrors)
+        return;
+
     std::ostringstream ostr;
     if (of == OUTPUT_FORMAT_XML)
     {
@@ -73,14 +79,32 @@ void ReportErr(OutputFormat of, const std::string &file, const int line, const s
         ostr << " (style): " << errmsg;
     }
 
+    if (RecordedErrors)
+        RecordedErrors->push_back(ostr.str());
+
+    ReportMessage(ostr.str(), errout);
+}
+
+void ReportMessage(const std::string &msg, std::ostream &errout)
+{
     // Avoid duplicate error messages..
-    if (ErrorList.find(ostr.str()) == ErrorList.end())
+    if (ErrorList.find(msg) == ErrorList.end())
     {
-        ErrorList.insert(ostr.str());
-        errout << ostr.str() << std::endl;
+        ErrorList.insert(msg);
+        errout << msg << std::endl;
     }
 }
 
+void RecordErrors(std::vector<std::string> *messages)
+{
+    RecordedErrors = messages;
+}
+
+void SuppressErrors(bool suppress)
+{
+    SuppressedErrors = suppress;
+}
+
 
 void ReportErr(const Tokenizer &tokenizer, OutputFormat of, const Token *tok, const std::string &id, const std::string &errmsg, std::ostream &errout)
 {
@@ -112,64 +136,81 @@ bool IsStandardType(const char str[])
 }
 //---------------------------------------------------------------------------
 
-bool Match(const Token *tok, const char pattern[])
+Pattern::Pattern(const char pattern[])
 {
-    if (!tok)
-        return false;
-
-    const char *p = pattern;
-    while (*p)
+    std::istringstream istr(pattern);
+    std::string str;
+    while (istr >> str)
     {
-        // Skip spaces in pattern..
-        while (*p == ' ')
-            p++;
-
-        // Extract token from pattern..
-        char str[50];
-        char *s = str;
-        while (*p && *p!=' ')
+        Element element;
+        element.str = str;
+
+        // Any symbolname..
+        if (str == "%var%" || str == "%type%")
+            element.kind = NAME;
+
+        else if (str == "%num%")
+            element.kind = NUMBER;
+
+        else if (str == "%str%")
+            element.kind = STRING;
+
+        // [.. => search for a one-character token..
+        else if (str[0] == '[' && str.find(']') != std::string::npos)
         {
-            *s = *p;
-            s++;
-            p++;
+            element.kind = CHARACTERS;
+            element.chars = str.substr(1, str.rfind(']') - 1);
         }
-        *s = 0;
 
-        // No token => Success!
-        if (str[0] == 0)
-            return true;
+        else
+            element.kind = LITERAL;
 
-        // Any symbolname..
-        if (strcmp(str,"%var%")==0 || strcmp(str,"%type%")==0)
+        elements.push_back(element);
+    }
+}
+//---------------------------------------------------------------------------
+
+bool Pattern::match(const Token *tok) const
+{
+    if (!tok)
+        return false;
+
+    for (std::vector<Element>::const_iterator it = elements.begin(); it != elements.end(); ++it)
+    {
+        switch (it->kind)
         {
+        case NAME:
             if (!IsName(tok->str))
                 return false;
-        }
+            break;
 
-        else if (strcmp(str,"%num%")==0)
-        {
-            if (! IsNumber(tok->str))
+        case NUMBER:
+            if (!IsNumber(tok->str))
                 return false;
-        }
-
+            break;
 
-        else if (strcmp(str,"%str%")==0)
-        {
+        case STRING:
             if (tok->str[0] != '\"')
                 return false;
-        }
+            break;
+
+        case CHARACTERS:
+            if (tok->str[1] == 0)
+            {
+                if (strchr(it->chars.c_str(), tok->str[0]) == 0)
+                    return false;
+            }
+            // multi character token => compare with the pattern text
+            else if (strcmp(tok->str, it->str.c_str()) != 0)
+                return false;
+            break;
 
-        // [.. => search for a one-character token..
-        else if (str[0]=='[' && strchr(str, ']') && tok->str[1] == 0)
-        {
-            *strrchr(str, ']') = 0;
-            if (strchr(str + 1, tok->str[0]) == 0)
+        case LITERAL:
+            if (tok->str[0] != it->str[0] || strcmp(tok->str, it->str.c_str()) != 0)
                 return false;
+            break;
         }
 
-        else if (strcmp(str, tok->str) != 0)
-            return false;
-
         tok = tok->next;
         if (!tok)
             return false;
@@ -180,6 +221,12 @@ bool Match(const Token *tok, const char pattern[])
 }
 //---------------------------------------------------------------------------
 
+bool Match(const Token *tok, const Pattern &pattern)
+{
+    return pattern.match(tok);
+}
+//---------------------------------------------------------------------------
+
 void deleteTokens(Token *tok)
 {
     while (tok)
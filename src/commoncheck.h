@@ -26,6 +26,7 @@
 
 #include <string>
 #include <sstream>
+#include <vector>
 
 struct Token;
 
@@ -35,12 +36,48 @@ bool SameFileName(const char fname1[], const char fname2[]);
 void ReportErr(OutputFormat of, const std::string &file, const int line, const std::string &id, const std::string &errmsg, std::ostream &errout);
 void ReportErr(const Tokenizer &tokenizer, OutputFormat of, const Token *tok, const std::string &id, const std::string &errmsg, std::ostream &errout);
 
+// Write a formatted error message unless it has been written already
+void ReportMessage(const std::string &msg, std::ostream &errout);
+
+// Record the formatted error messages, also those that are not written
+// because they are duplicates. NULL => stop recording.
+void RecordErrors(std::vector<std::string> *messages);
+
+// Don't report or record errors. Used when files are only tokenized to
+// extract their symbols.
+void SuppressErrors(bool suppress);
+
 bool IsName(const char str[]);
 bool IsNumber(const char str[]);
 
 bool IsStandardType(const char str[]);
 
-bool Match(const Token *tok, const char pattern[]);
+/**
+ * A token pattern that is parsed once. The tokens of the pattern are
+ * separated by spaces, "%var%" / "%type%" is any name, "%num%" any number,
+ * "%str%" any string and "[abc]" any of the characters.
+ */
+class Pattern
+{
+public:
+    explicit Pattern(const char pattern[]);
+
+    bool match(const Token *tok) const;
+
+private:
+    enum Kind { NAME, NUMBER, STRING, CHARACTERS, LITERAL };
+
+    struct Element
+    {
+        Kind kind;
+        std::string str;     // pattern text
+        std::string chars;   // characters in "[abc]"
+    };
+
+    std::vector<Element> elements;
+};
+
+bool Match(const Token *tok, const Pattern &pattern);
 
 void deleteTokens(Token *tok);
 //---------------------------------------------------------------------------
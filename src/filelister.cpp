@@ -23,6 +23,8 @@
 #include <string>
 #include <cctype>
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 
 #if defined(__GNUC__) && !defined(__MINGW32__)
 #include <glob.h>
@@ -34,6 +36,10 @@
 #include <shlwapi.h>
 #endif
 #endif
+#if defined(__BORLANDC__) || defined(_MSC_VER)
+#define popen _popen
+#define pclose _pclose
+#endif
 
 std::string FileLister::simplifyPath(const char *originalPath)
 {
@@ -90,6 +96,32 @@ std::string FileLister::simplifyPath(const char *originalPath)
 
 
 
+std::string FileLister::absolutePath(const std::string &path)
+{
+#if defined(__GNUC__) && !defined(__MINGW32__)
+    char *resolved = realpath(path.c_str(), NULL);
+    if (resolved)
+    {
+        const std::string result(resolved);
+        free(resolved);
+        return result;
+    }
+
+    // The file doesn't exist, for example it is deleted..
+    if (!path.empty() && path[0] == '/')
+        return simplifyPath(path.c_str());
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd)))
+        return simplifyPath(path.c_str());
+    return simplifyPath((std::string(cwd) + "/" + path).c_str());
+#else
+    char resolved[_MAX_PATH];
+    if (_fullpath(resolved, path.c_str(), _MAX_PATH))
+        return resolved;
+    return simplifyPath(path.c_str());
+#endif
+}
+
 bool FileLister::acceptFile(const std::string &filename)
 {
     std::string::size_type dotLocation = filename.find_last_of('.');
@@ -112,13 +144,89 @@ bool FileLister::acceptFile(const std::string &filename)
     return false;
 }
 
+bool FileLister::acceptHeader(const std::string &filename)
+{
+    std::string::size_type dotLocation = filename.find_last_of('.');
+    if (dotLocation == std::string::npos)
+        return false;
+
+    std::string extension = filename.substr(dotLocation);
+    std::transform(extension.begin(), extension.end(), extension.begin(), static_cast < int(*)(int) > (std::tolower));
+
+    return bool(extension == ".h" ||
+                extension == ".hpp" ||
+                extension == ".hxx" ||
+                extension == ".hh" ||
+                extension == ".h++");
+}
+
+// Run a git command that prints file names relative to the top-level
+// directory of the repository, separated by null characters
+static bool gitFileNames(const std::string &command, std::vector<std::string> &filenames)
+{
+    FILE *f = popen("git rev-parse --show-toplevel", "r");
+    if (!f)
+        return false;
+    std::string topLevel;
+    int c;
+    while ((c = fgetc(f)) != EOF && c != '\n')
+        topLevel.append(1, char(c));
+    if (pclose(f) != 0 || topLevel.empty())
+        return false;
+    topLevel += '/';
+
+    f = popen(command.c_str(), "r");
+    if (!f)
+        return false;
+
+    std::string filename;
+    while ((c = fgetc(f)) != EOF)
+    {
+        if (c != '\0')
+            filename.append(1, char(c));
+        else if (!filename.empty())
+        {
+            filenames.push_back(topLevel + filename);
+            filename = "";
+        }
+    }
+    if (!filename.empty())
+        filenames.push_back(topLevel + filename);
+
+    return bool(pclose(f) == 0);
+}
+
+bool FileLister::changedFiles(std::vector<std::string> &filenames, const std::string &revision)
+{
+    // The revision is passed to the shell, so only accept characters that
+    // can be used in git revisions..
+    if (revision.empty() || revision[0] == '-')
+        return false;
+    for (std::string::size_type i = 0; i < revision.length(); ++i)
+    {
+        const unsigned char c = revision[i];
+        if (!std::isalnum(c) && !std::strchr("._-/~^@{}", c))
+            return false;
+    }
+
+    return gitFileNames("git diff --name-only -z " + revision + " --", filenames);
+}
+
+bool FileLister::recentChanges(std::vector<std::string> &filenames, unsigned int commits)
+{
+    std::ostringstream command;
+    command << "git log --format= --name-only -z -n " << commits << " --";
+    return gitFileNames(command.str(), filenames);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ////// This code is for __GNUC__ only /////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
 #if defined(__GNUC__) && !defined(__MINGW32__)
 // gcc / cygwin..
-void FileLister::recursiveAddFiles(std::vector<std::string> &filenames, const std::string &path, bool recursive)
+void FileLister::recursiveAddFiles(std::vector<std::string> &filenames, const std::string &path, bool recursive,
+                                   bool (*accept)(const std::string &filename))
 {
     std::ostringstream oss;
     oss << path;
@@ -138,13 +246,13 @@ void FileLister::recursiveAddFiles(std::vector<std::string> &filenames, const st
             // File
 
             // If recursive is not used, accept all files given by user
-            if (!recursive || FileLister::acceptFile(filename))
+            if (!recursive || accept(filename))
                 filenames.push_back(filename);
         }
         else if (recursive)
         {
             // Directory
-            FileLister::recursiveAddFiles(filenames, filename, recursive);
+            FileLister::recursiveAddFiles(filenames, filename, recursive, accept);
         }
     }
     globfree(&glob_results);
@@ -217,7 +325,8 @@ static HANDLE MyFindFirstFile(std::string path, LPWIN32_FIND_DATA findData)
 
 #endif // defined(UNICODE)
 
-void FileLister::recursiveAddFiles(std::vector<std::string> &filenames, const std::string &path, bool recursive)
+void FileLister::recursiveAddFiles(std::vector<std::string> &filenames, const std::string &path, bool recursive,
+                                   bool (*accept)(const std::string &filename))
 {
     // oss is the search string passed into FindFirst and FindNext.
     // bdir is the base directory which is used to form pathnames.
@@ -281,13 +390,13 @@ void FileLister::recursiveAddFiles(std::vector<std::string> &filenames, const st
             // File
 
             // If recursive is not used, accept all files given by user
-            if (!recursive || FileLister::acceptFile(ansiFfd))
+            if (!recursive || accept(ansiFfd))
                 filenames.push_back(fname.str());
         }
         else if (recursive)
         {
             // Directory
-            FileLister::recursiveAddFiles(filenames, fname.str().c_str(), recursive);
+            FileLister::recursiveAddFiles(filenames, fname.str().c_str(), recursive, accept);
         }
 #if defined(UNICODE)
         delete [] ansiFfd;
@@ -42,10 +42,34 @@
 class FileLister
 {
 public:
-    static void recursiveAddFiles(std::vector<std::string> &filenames, const std::string &path, bool recursive);
+    static void recursiveAddFiles(std::vector<std::string> &filenames, const std::string &path, bool recursive,
+                                  bool (*accept)(const std::string &filename) = acceptFile);
     static std::string simplifyPath(const char *originalPath);
+
+    /**
+     * get the absolute path of a file, with symbolic links resolved if
+     * the file exists. Paths of the same file can be compared this way.
+     */
+    static std::string absolutePath(const std::string &path);
     static bool sameFileName(const char fname1[], const char fname2[]);
     static bool acceptFile(const std::string &filename);
+    static bool acceptHeader(const std::string &filename);
+
+    /**
+     * get the files that are changed in the working tree compared to a
+     * git revision. The paths start with the top-level directory of the
+     * repository.
+     * @return false if git failed
+     */
+    static bool changedFiles(std::vector<std::string> &filenames, const std::string &revision);
+
+    /**
+     * get the files that are changed in the latest git commits. A file is
+     * listed once for each commit that changes it. The paths start with the
+     * top-level directory of the repository.
+     * @return false if git failed
+     */
+    static bool recentChanges(std::vector<std::string> &filenames, unsigned int commits);
 private:
 
 };
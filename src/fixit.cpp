@@ -0,0 +1,454 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+#include "fixit.h"
+#include "checkheaders.h"
+#include "filelister.h"
+#include "includegraph.h"
+#include "symbolcache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+//---------------------------------------------------------------------------
+
+// Lines of context around the changes in the diff
+static const unsigned int diffContext = 3;
+//---------------------------------------------------------------------------
+
+void FixIts::replaceLine(const std::string &filename, unsigned int linenr,
+                         const std::string &header, const std::vector<std::string> &lines)
+{
+    FileChanges &fileChanges = changes[filename];
+    if (fileChanges.find(linenr) == fileChanges.end())
+    {
+        Change &change = fileChanges[linenr];
+        change.header = header;
+        change.lines = lines;
+    }
+}
+//---------------------------------------------------------------------------
+
+// Split contents to lines. The line endings are kept.
+static void splitLines(std::istream &istr, std::vector<std::string> &lines)
+{
+    std::string line;
+    while (std::getline(istr, line))
+        lines.push_back(istr.eof() ? line : (line + "\n"));
+}
+
+// Read the lines of a file
+static bool readLines(const std::string &filename, std::vector<std::string> &lines)
+{
+    std::ifstream fin(filename.c_str(), std::ios::binary);
+    if (!fin.is_open())
+        return false;
+
+    splitLines(fin, lines);
+    return true;
+}
+
+// Is the line an #include directive of the header: #include "header" or #include <header>
+static bool includesHeader(const std::string &line, const std::string &header)
+{
+    std::string::size_type pos = line.find_first_not_of(" \t");
+    if (pos == std::string::npos || line[pos] != '#')
+        return false;
+    pos = line.find_first_not_of(" \t", pos + 1);
+    if (pos == std::string::npos || line.compare(pos, 7, "include") != 0)
+        return false;
+    pos = line.find_first_not_of(" \t", pos + 7);
+    if (pos == std::string::npos || (line[pos] != '\"' && line[pos] != '<'))
+        return false;
+
+    const char close = (line[pos] == '<') ? '>' : '\"';
+    const std::string::size_type end = pos + 1 + header.size();
+    return bool(line.compare(pos + 1, header.size(), header) == 0 && end < line.size() && line[end] == close);
+}
+
+FixIts::FileChanges FixIts::validChanges(const std::string &filename, const FileChanges &fileChanges,
+                                         const std::vector<std::string> &lines, std::ostream *warnings) const
+{
+    FileChanges valid;
+    for (FileChanges::const_iterator change = fileChanges.begin(); change != fileChanges.end(); ++change)
+    {
+        if (change->first <= lines.size() && includesHeader(lines[change->first - 1], change->second.header))
+            valid.insert(*change);
+        else if (warnings)
+            *warnings << "checkheaders: " << filename << ":" << change->first
+                      << " is not the #include of '" << change->second.header << "', it is not fixed" << std::endl;
+    }
+    return valid;
+}
+
+// The line ending of the file: the line ending of the first line
+static std::string lineEnding(const std::vector<std::string> &lines)
+{
+    if (!lines.empty() && lines[0].size() > 1 && lines[0].compare(lines[0].size() - 2, 2, "\r\n") == 0)
+        return "\r\n";
+    return "\n";
+}
+
+// Does the line end with a newline. The last line of a file may not.
+static bool hasNewline(const std::string &line)
+{
+    return bool(!line.empty() && line[line.size() - 1] == '\n');
+}
+
+// Write a line of the diff. The line may lack a newline at the end of the file.
+static void writeDiffLine(std::ostream &out, char prefix, const std::string &line)
+{
+    out << prefix << line;
+    if (!hasNewline(line))
+        out << "\n\\ No newline at end of file\n";
+}
+
+bool FixIts::writeDiff(std::ostream &out, std::ostream &warnings) const
+{
+    bool ok = true;
+    for (std::map<std::string, FileChanges>::const_iterator file = changes.begin(); file != changes.end(); ++file)
+    {
+        std::vector<std::string> lines;
+        if (!readLines(file->first, lines))
+        {
+            ok = false;
+            continue;
+        }
+
+        // Only the lines that are the expected #include directives are changed..
+        const FileChanges fileChanges(validChanges(file->first, file->second, lines, &warnings));
+        if (fileChanges.empty())
+            continue;
+
+        // The new lines get the line ending of the file
+        const std::string eol(lineEnding(lines));
+
+        out << "--- " << file->first << "\n"
+            << "+++ " << file->first << "\n";
+
+        // Changes that are close to each other are written in the same hunk..
+        int offset = 0;
+        FileChanges::const_iterator change = fileChanges.begin();
+        while (change != fileChanges.end())
+        {
+            FileChanges::const_iterator last = change;
+            FileChanges::const_iterator next = change;
+            int added = 0;
+            for (++next; ; ++next)
+            {
+                added += int(last->second.lines.size()) - 1;
+                if (next == fileChanges.end() || next->first > last->first + 2 * diffContext + 1)
+                    break;
+                last = next;
+            }
+
+            const unsigned int begin = (change->first > diffContext) ? (change->first - diffContext) : 1;
+            const unsigned int end = std::min<unsigned int>(last->first + diffContext, lines.size());
+            const int oldCount = end - begin + 1;
+            const int newCount = oldCount + added;
+            out << "@@ -" << begin << "," << oldCount
+                << " +" << ((newCount > 0) ? (int(begin) + offset) : (int(begin) + offset - 1)) << "," << newCount
+                << " @@\n";
+
+            for (unsigned int linenr = begin; linenr <= end; ++linenr)
+            {
+                const FileChanges::const_iterator replaced = fileChanges.find(linenr);
+                if (replaced == fileChanges.end())
+                {
+                    writeDiffLine(out, ' ', lines[linenr - 1]);
+                    continue;
+                }
+                writeDiffLine(out, '-', lines[linenr - 1]);
+
+                // The last new line replaces the last line of the file without a newline..
+                const std::vector<std::string> &newLines = replaced->second.lines;
+                for (unsigned int i = 0; i < newLines.size(); ++i)
+                {
+                    if (i + 1 == newLines.size() && !hasNewline(lines[linenr - 1]))
+                        writeDiffLine(out, '+', newLines[i]);
+                    else
+                        out << "+" << newLines[i] << eol;
+                }
+            }
+
+            offset += added;
+            change = next;
+        }
+    }
+    return ok;
+}
+//---------------------------------------------------------------------------
+
+std::vector<std::string> FixIts::getFiles() const
+{
+    std::vector<std::string> files;
+    for (std::map<std::string, FileChanges>::const_iterator file = changes.begin(); file != changes.end(); ++file)
+        files.push_back(file->first);
+    return files;
+}
+//---------------------------------------------------------------------------
+
+std::vector<unsigned int> FixIts::getLines(const std::string &filename) const
+{
+    std::vector<unsigned int> linenrs;
+    const std::map<std::string, FileChanges>::const_iterator file = changes.find(filename);
+    if (file != changes.end())
+    {
+        for (FileChanges::const_iterator change = file->second.begin(); change != file->second.end(); ++change)
+            linenrs.push_back(change->first);
+    }
+    return linenrs;
+}
+//---------------------------------------------------------------------------
+
+std::vector<unsigned int> FixIts::getValidLines(const std::string &filename, const std::string &contents,
+                                                std::ostream &warnings) const
+{
+    std::vector<unsigned int> linenrs;
+    const std::map<std::string, FileChanges>::const_iterator file = changes.find(filename);
+    if (file == changes.end())
+        return linenrs;
+
+    std::vector<std::string> lines;
+    std::istringstream istr(contents);
+    splitLines(istr, lines);
+
+    const FileChanges fileChanges(validChanges(filename, file->second, lines, &warnings));
+    for (FileChanges::const_iterator change = fileChanges.begin(); change != fileChanges.end(); ++change)
+        linenrs.push_back(change->first);
+    return linenrs;
+}
+//---------------------------------------------------------------------------
+
+std::string FixIts::apply(const std::string &filename, const std::string &contents,
+                          const std::vector<unsigned int> &linenrs) const
+{
+    const std::map<std::string, FileChanges>::const_iterator file = changes.find(filename);
+    if (file == changes.end())
+        return contents;
+
+    std::vector<std::string> lines;
+    std::istringstream istr(contents);
+    splitLines(istr, lines);
+    const std::string eol(lineEnding(lines));
+    const FileChanges fileChanges(validChanges(filename, file->second, lines, NULL));
+
+    std::ostringstream ostr;
+    for (unsigned int linenr = 1; linenr <= lines.size(); ++linenr)
+    {
+        const FileChanges::const_iterator change = fileChanges.find(linenr);
+        if (change == fileChanges.end() ||
+            std::find(linenrs.begin(), linenrs.end(), linenr) == linenrs.end())
+        {
+            ostr << lines[linenr - 1];
+            continue;
+        }
+        // The missing newline at the end of the file is kept
+        const std::vector<std::string> &newLines = change->second.lines;
+        for (unsigned int i = 0; i < newLines.size(); ++i)
+        {
+            ostr << newLines[i];
+            if (i + 1 < newLines.size() || hasNewline(lines[linenr - 1]))
+                ostr << eol;
+        }
+    }
+    return ostr.str();
+}
+//---------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------
+// Fixing
+//---------------------------------------------------------------------------
+
+static std::string readFile(const std::string &filename)
+{
+    std::ifstream fin(filename.c_str(), std::ios::binary);
+    std::ostringstream ostr;
+    ostr << fin.rdbuf();
+    return ostr.str();
+}
+
+static bool writeFile(const std::string &filename, const std::string &contents)
+{
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    fout << contents;
+    return fout.good();
+}
+
+// The problems that a change must not add: includes that are not found
+// and needed symbols that are not declared
+static std::set<std::string> FixProblems(const std::vector<std::string> &sources,
+                                         const std::vector<std::string> &includePaths,
+                                         const std::set<std::string> &skipIncludes,
+                                         SymbolCache &cache)
+{
+    Options options;
+    options.Progress = false;
+    options.IgnoreMissingIncludeFile = true;
+
+    std::set<std::string> problems;
+    for (unsigned int i = 0; i < sources.size(); ++i)
+    {
+        std::ostringstream errout;
+        Tokenizer tokenizer;
+        tokenizer.tokenize(sources[i].c_str(), includePaths, skipIncludes, &options, errout);
+
+        for (unsigned int k = 0; k < tokenizer.Includes.size(); ++k)
+        {
+            const Tokenizer::IncludeDirective &include = tokenizer.Includes[k];
+            if (include.path.empty())
+                problems.insert(tokenizer.FullFileNames[include.FileIndex] + ": header not found '" + include.header + "'");
+        }
+
+        const std::set<std::string> missing(MissingSymbols(tokenizer, &cache));
+        for (std::set<std::string>::const_iterator it = missing.begin(); it != missing.end(); ++it)
+            problems.insert(*it + " is not declared");
+    }
+    return problems;
+}
+
+// Get a problem that is not in the old problems. Empty if there is none.
+static std::string NewProblem(const std::set<std::string> &oldProblems, const std::set<std::string> &problems)
+{
+    for (std::set<std::string>::const_iterator it = problems.begin(); it != problems.end(); ++it)
+    {
+        if (oldProblems.find(*it) == oldProblems.end())
+            return *it;
+    }
+    return "";
+}
+
+bool FixIts::fix(const IncludeGraph &includeGraph, const std::vector<std::string> &filenames,
+                 const std::vector<std::string> &includePaths, const std::set<std::string> &skipIncludes,
+                 std::ostream &out) const
+{
+    std::set<std::string> checked;
+    for (unsigned int i = 0; i < filenames.size(); ++i)
+        checked.insert(FileLister::absolutePath(filenames[i]));
+
+    // Dependency order: the distance from the source files in the include graph..
+    std::map<std::string, unsigned int> distance;
+    std::vector<std::string> todo;
+    const std::map<std::string, IncludeGraph::File> &files = includeGraph.getFiles();
+    for (std::map<std::string, IncludeGraph::File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        if (it->second.source)
+        {
+            distance[it->first] = 0;
+            todo.push_back(it->first);
+        }
+    }
+    for (unsigned int i = 0; i < todo.size(); ++i)
+    {
+        const std::map<std::string, IncludeGraph::File>::const_iterator file = files.find(todo[i]);
+        for (unsigned int k = 0; k < file->second.includes.size(); ++k)
+        {
+            const std::string &path = file->second.includes[k].path;
+            if (!path.empty() && files.count(path) && distance.find(path) == distance.end())
+            {
+                distance[path] = distance[todo[i]] + 1;
+                todo.push_back(path);
+            }
+        }
+    }
+
+    std::vector< std::pair<unsigned int, std::string> > order;
+    const std::vector<std::string> changedFiles(getFiles());
+    for (unsigned int i = 0; i < changedFiles.size(); ++i)
+    {
+        const std::map<std::string, unsigned int>::const_iterator it = distance.find(changedFiles[i]);
+        order.push_back(std::make_pair(it == distance.end() ? ~0U : it->second, changedFiles[i]));
+    }
+    std::sort(order.begin(), order.end());
+
+    // Headers are summarized again when they change, so a separate cache is used
+    SymbolCache cache;
+
+    bool written = true;
+    for (unsigned int i = 0; i < order.size(); ++i)
+    {
+        const std::string &filename = order[i].second;
+
+        // The checked source files that are affected by the change..
+        std::vector<std::string> sources;
+        if (checked.count(FileLister::absolutePath(filename)))
+            sources.push_back(filename);
+        const std::vector<std::string> includers(includeGraph.whoIncludes(filename, true));
+        for (unsigned int k = 0; k < includers.size(); ++k)
+        {
+            if (files.find(includers[k])->second.source && checked.count(FileLister::absolutePath(includers[k])))
+                sources.push_back(includers[k]);
+        }
+
+        const std::string contents(readFile(filename));
+
+        // Only the lines that are the expected #include directives are changed..
+        const unsigned int fileChanges = getLines(filename).size();
+        const std::vector<unsigned int> linenrs(getValidLines(filename, contents, out));
+        if (linenrs.empty())
+            continue;
+
+        const std::set<std::string> problems(FixProblems(sources, includePaths, skipIncludes, cache));
+
+        // Try all the changes of the file, and if that fails each change..
+        const std::string notWritten("the file could not be written");
+        std::vector<unsigned int> applied(linenrs);
+        std::string problem;
+        if (writeFile(filename, apply(filename, contents, applied)))
+            problem = NewProblem(problems, FixProblems(sources, includePaths, skipIncludes, cache));
+        else
+            problem = notWritten;
+
+        if (!problem.empty() && linenrs.size() > 1 && problem != notWritten)
+        {
+            applied.clear();
+            for (unsigned int k = 0; k < linenrs.size(); ++k)
+            {
+                applied.push_back(linenrs[k]);
+                if (writeFile(filename, apply(filename, contents, applied)))
+                    problem = NewProblem(problems, FixProblems(sources, includePaths, skipIncludes, cache));
+                else
+                    problem = notWritten;
+                if (!problem.empty())
+                {
+                    applied.pop_back();
+                    out << "Undoing the fix of " << filename << ":" << linenrs[k] << " (" << problem << ")" << std::endl;
+                }
+                if (problem == notWritten)
+                    break;
+            }
+        }
+        else if (!problem.empty())
+        {
+            applied.clear();
+            out << "Undoing the fix of " << filename << ":" << linenrs[0] << " (" << problem << ")" << std::endl;
+        }
+
+        if (!writeFile(filename, apply(filename, contents, applied)))
+        {
+            out << "checkheaders: failed to write '" << filename << "'" << std::endl;
+            written = false;
+        }
+        else if (!applied.empty())
+            out << "Fixed " << applied.size() << " of " << fileChanges << " includes in " << filename << std::endl;
+    }
+    return written;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,126 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+#ifndef fixitH
+#define fixitH
+//---------------------------------------------------------------------------
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+class IncludeGraph;
+
+/**
+ * Changes to source files that fix reported errors. Each change replaces
+ * the #include directive on one line of a file with zero or more lines.
+ * A change is only made if the line is the expected #include directive.
+ * The changes can be written as a unified diff.
+ */
+class FixIts
+{
+public:
+    /**
+     * replace a line of a file. If the line has been replaced already the
+     * first replacement is kept.
+     * @param filename file name
+     * @param linenr line number, 1 for the first line
+     * @param header the header that the #include directive on the line includes
+     * @param lines the new lines without line endings
+     */
+    void replaceLine(const std::string &filename, unsigned int linenr,
+                     const std::string &header, const std::vector<std::string> &lines);
+
+    bool empty() const
+    {
+        return changes.empty();
+    }
+
+    /**
+     * write the changes as a unified diff with the file names as they are
+     * ("patch -p0" applies it)
+     * @param out the diff
+     * @param warnings the changes whose line is not the expected #include
+     *                 are reported here and they are left out of the diff
+     * @return false if a changed file could not be read
+     */
+    bool writeDiff(std::ostream &out, std::ostream &warnings) const;
+
+    /** get the changed files */
+    std::vector<std::string> getFiles() const;
+
+    /** get the changed lines of a file */
+    std::vector<unsigned int> getLines(const std::string &filename) const;
+
+    /**
+     * get the changed lines of a file that are the expected #include directives
+     * @param filename file name
+     * @param contents the contents of the file
+     * @param warnings the other changed lines are reported here
+     */
+    std::vector<unsigned int> getValidLines(const std::string &filename, const std::string &contents,
+                                            std::ostream &warnings) const;
+
+    /**
+     * apply some of the changes of a file. Lines that are not the expected
+     * #include directives are not changed.
+     * @param filename file name
+     * @param contents the contents of the file that the changes are for
+     * @param linenrs the changed lines to apply
+     * @return the changed contents
+     */
+    std::string apply(const std::string &filename, const std::string &contents,
+                      const std::vector<unsigned int> &linenrs) const;
+
+    /**
+     * apply the changes to the files. The files are changed in dependency
+     * order, the files that include a file are changed before it. After each
+     * change the checked source files that include the changed file are
+     * checked again and a change that adds a problem is undone.
+     * @param includeGraph include graph of the checked files
+     * @param filenames the checked source files
+     * @param includePaths search paths for the headers
+     * @param skipIncludes skip #include that match
+     * @param out the fixed and undone changes are reported here
+     * @return false if a file could not be written
+     */
+    bool fix(const IncludeGraph &includeGraph, const std::vector<std::string> &filenames,
+             const std::vector<std::string> &includePaths, const std::set<std::string> &skipIncludes,
+             std::ostream &out) const;
+
+private:
+    struct Change
+    {
+        std::string header;               // the header that the replaced line includes
+        std::vector<std::string> lines;   // the new lines
+    };
+    typedef std::map<unsigned int, Change> FileChanges;
+
+    // The changes of a file whose lines are the expected #include directives
+    FileChanges validChanges(const std::string &filename, const FileChanges &fileChanges,
+                             const std::vector<std::string> &lines, std::ostream *warnings) const;
+
+    std::map<std::string, FileChanges> changes;
+};
+
+//---------------------------------------------------------------------------
+#endif
+
@@ -0,0 +1,134 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+#include "headerusage.h"
+
+#include <algorithm>
+//---------------------------------------------------------------------------
+
+void HeaderUsage::addHeader(const std::string &path, unsigned int tokens, const std::vector<std::string> &symbols)
+{
+    Header &header = headers[path];
+    header.tokens = tokens;
+    header.symbols = symbols;
+    std::sort(header.symbols.begin(), header.symbols.end());
+    header.symbols.erase(std::unique(header.symbols.begin(), header.symbols.end()), header.symbols.end());
+}
+
+void HeaderUsage::addUsage(const std::string &header, const std::string &includer, const std::vector<std::string> &symbols)
+{
+    if (!symbols.empty())
+        headers[header].usage[includer].insert(symbols.begin(), symbols.end());
+}
+//---------------------------------------------------------------------------
+
+// Find the group of a symbol, the groups are merged as union-find sets
+static unsigned int findGroup(std::vector<unsigned int> &group, unsigned int i)
+{
+    while (group[i] != i)
+    {
+        group[i] = group[group[i]];
+        i = group[i];
+    }
+    return i;
+}
+
+static bool moreSaved(const HeaderUsage::Split &split1, const HeaderUsage::Split &split2)
+{
+    if (split1.savedTokens != split2.savedTokens)
+        return split1.savedTokens > split2.savedTokens;
+    return split1.path < split2.path;
+}
+
+std::vector<HeaderUsage::Split> HeaderUsage::suggestSplits() const
+{
+    std::vector<Split> result;
+    for (std::map<std::string, Header>::const_iterator it = headers.begin(); it != headers.end(); ++it)
+    {
+        const Header &header = it->second;
+        if (header.usage.size() < 2 || header.symbols.empty())
+            continue;
+
+        // Symbols that a file uses together are in the same group..
+        std::vector<unsigned int> group(header.symbols.size());
+        for (unsigned int i = 0; i < group.size(); ++i)
+            group[i] = i;
+        std::vector<unsigned int> includerSymbol;
+        for (std::map<std::string, std::set<std::string> >::const_iterator usage = header.usage.begin(); usage != header.usage.end(); ++usage)
+        {
+            unsigned int first = header.symbols.size();
+            for (std::set<std::string>::const_iterator sym = usage->second.begin(); sym != usage->second.end(); ++sym)
+            {
+                const std::vector<std::string>::const_iterator pos = std::lower_bound(header.symbols.begin(), header.symbols.end(), *sym);
+                if (pos == header.symbols.end() || *pos != *sym)
+                    continue;
+                const unsigned int i = pos - header.symbols.begin();
+                if (first == header.symbols.size())
+                    first = i;
+                else
+                    group[findGroup(group, i)] = findGroup(group, first);
+            }
+            if (first < header.symbols.size())
+                includerSymbol.push_back(first);
+        }
+        if (includerSymbol.size() < 2)
+            continue;
+
+        // The groups that are used, and how many files use each..
+        std::map<unsigned int, unsigned int> groupIncluders;
+        for (unsigned int i = 0; i < includerSymbol.size(); ++i)
+            ++groupIncluders[findGroup(group, includerSymbol[i])];
+        if (groupIncluders.size() < 2)
+            continue;
+
+        // The most used group first, ~ sorts the counts in descending order..
+        std::vector< std::pair<unsigned int, unsigned int> > order;
+        for (std::map<unsigned int, unsigned int>::const_iterator g = groupIncluders.begin(); g != groupIncluders.end(); ++g)
+            order.push_back(std::make_pair(~g->second, g->first));
+        std::sort(order.begin(), order.end());
+
+        Split split;
+        split.path = it->first;
+        split.tokens = header.tokens;
+        split.includers = includerSymbol.size();
+        split.savedTokens = 0;
+        for (unsigned int k = 0; k < order.size(); ++k)
+        {
+            const unsigned int g = order[k].second;
+            std::vector<std::string> part;
+            for (unsigned int i = 0; i < header.symbols.size(); ++i)
+            {
+                if (findGroup(group, i) == g)
+                    part.push_back(header.symbols[i]);
+            }
+
+            const unsigned int tokens = (unsigned int)((unsigned long)header.tokens * part.size() / header.symbols.size());
+            split.parts.push_back(part);
+            split.partIncluders.push_back(groupIncluders[g]);
+            split.partTokens.push_back(tokens);
+            split.savedTokens += (unsigned long)groupIncluders[g] * (header.tokens - tokens);
+        }
+        result.push_back(split);
+    }
+
+    std::sort(result.begin(), result.end(), moreSaved);
+    return result;
+}
+//---------------------------------------------------------------------------
+
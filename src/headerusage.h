@@ -0,0 +1,91 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+#ifndef headerusageH
+#define headerusageH
+//---------------------------------------------------------------------------
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * Which symbols of each header the files that include it use. The usage
+ * is collected from all checked source files, headers whose includers
+ * use disjoint groups of symbols can be split so each includer only
+ * parses the group that it needs.
+ */
+class HeaderUsage
+{
+public:
+    /** A suggested split of a header */
+    struct Split
+    {
+        std::string path;
+        unsigned int tokens;                            // tokens of the header
+        unsigned int includers;                         // files that include the header and use some symbol of it
+        std::vector< std::vector<std::string> > parts;  // the symbols of each new header, the most used first
+        std::vector<unsigned int> partIncluders;        // files that use each new header
+        std::vector<unsigned int> partTokens;           // estimated tokens of each new header
+        unsigned long savedTokens;                      // estimated tokens that the includers don't parse
+    };
+
+    /**
+     * add a header
+     * @param path path of the header
+     * @param tokens tokens of the header
+     * @param symbols the symbols that the header declares
+     */
+    void addHeader(const std::string &path, unsigned int tokens, const std::vector<std::string> &symbols);
+
+    /**
+     * add the symbols of a header that a file that includes it uses
+     * @param header path of the header
+     * @param includer path of the file that includes the header
+     * @param symbols the used symbols. If there are none the include is not counted.
+     */
+    void addUsage(const std::string &header, const std::string &includer, const std::vector<std::string> &symbols);
+
+    /**
+     * suggest splits for the headers whose symbols are used in disjoint
+     * groups: no file that includes the header uses symbols of two groups.
+     * The tokens of a new header are estimated from the share of the
+     * symbols it gets, the symbols that no includer uses are left out.
+     * @return the splits, the most saved tokens first
+     */
+    std::vector<Split> suggestSplits() const;
+
+private:
+    struct Header
+    {
+        Header() : tokens(0)
+        { }
+
+        unsigned int tokens;
+        std::vector<std::string> symbols;
+        std::map<std::string, std::set<std::string> > usage;   // used symbols of each includer
+    };
+
+    std::map<std::string, Header> headers;
+};
+
+//---------------------------------------------------------------------------
+#endif
+
@@ -0,0 +1,813 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+#include "includegraph.h"
+#include "filelister.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+//---------------------------------------------------------------------------
+
+// Graph file format. One line per file and one line per include, the
+// fields are separated by tabs:
+//   checkheaders include graph 3
+//   S <path> <bytes> <tokens>                      checked source file
+//   H <path> <bytes> <tokens>                      header
+//   I <line> <header> <included path> <unneeded>   include in the previous file
+
+static const char graphMagic[] = "checkheaders include graph 3";
+//---------------------------------------------------------------------------
+
+void IncludeGraph::add(const Tokenizer &tokenizer, const std::set<std::string> *unneededIncludes)
+{
+    addFiles(tokenizer, true, unneededIncludes);
+}
+//---------------------------------------------------------------------------
+
+void IncludeGraph::addFiles(const Tokenizer &tokenizer, bool source, const std::set<std::string> *unneededIncludes)
+{
+    std::vector<File *> tokenized(tokenizer.FullFileNames.size(), static_cast<File *>(NULL));
+    for (unsigned int i = 0; i < tokenizer.FullFileNames.size(); ++i)
+    {
+        if (!source && files.find(tokenizer.FullFileNames[i]) != files.end())
+            continue;
+        File &file = files[tokenizer.FullFileNames[i]];
+        file.includes.clear();
+        file.bytes = tokenizer.FileSizes[i];
+        file.tokens = tokenizer.FileTokens[i];
+        if (i == 0 && source)
+            file.source = true;
+        tokenized[i] = &file;
+    }
+
+    for (unsigned int i = 0; i < tokenizer.Includes.size(); ++i)
+    {
+        const Tokenizer::IncludeDirective &directive = tokenizer.Includes[i];
+        if (!tokenized[directive.FileIndex])
+            continue;
+        Include include;
+        include.linenr = directive.linenr;
+        include.header = directive.SystemHeader ? ("<" + directive.header + ">") : directive.header;
+        include.path = directive.path;
+        if (unneededIncludes)
+        {
+            std::ostringstream line;
+            line << tokenizer.FullFileNames[directive.FileIndex] << ':' << directive.linenr;
+            include.unneeded = bool(unneededIncludes->count(line.str()) > 0);
+        }
+        tokenized[directive.FileIndex]->includes.push_back(include);
+    }
+
+    // The files that are identical to a tokenized file have the same
+    // includes, but they are resolved from their own directory..
+    for (unsigned int i = 0; i < tokenizer.FileAliases.size(); ++i)
+    {
+        const std::string &path = tokenizer.AliasFullFileNames[i];
+        if (!source && files.find(path) != files.end())
+            continue;
+
+        std::vector<std::string> includePaths;
+        if (path.find_first_of("\\/") != std::string::npos)
+            includePaths.push_back(path.substr(0, 1 + path.find_last_of("\\/")));
+        includePaths.insert(includePaths.end(), tokenizer.IncludePaths.begin(), tokenizer.IncludePaths.end());
+
+        const File identical(files[tokenizer.FullFileNames[tokenizer.FileAliases[i].second]]);
+        File &file = files[path];
+        file.includes.clear();
+        file.bytes = identical.bytes;
+        file.tokens = identical.tokens;
+        for (std::vector<Include>::const_iterator it = identical.includes.begin(); it != identical.includes.end(); ++it)
+        {
+            Include include;
+            include.linenr = it->linenr;
+            include.header = it->header;
+            const std::string header(it->header[0] == '<' ? it->header.substr(1, it->header.size() - 2) : it->header);
+            include.path = Tokenizer::findFile(header.c_str(), includePaths);
+            file.includes.push_back(include);
+        }
+
+        // The included files that are not in the graph are not tokenized,
+        // only their includes are resolved
+        for (std::vector<Include>::const_iterator include = file.includes.begin(); include != file.includes.end(); ++include)
+        {
+            if (include->path.empty() || files.find(include->path) != files.end())
+                continue;
+            Options options;
+            options.Progress = false;
+            options.IgnoreMissingIncludeFile = true;
+            std::ostringstream errout;
+            Tokenizer scanned;
+            scanned.scanIncludes(include->path.c_str(), tokenizer.IncludePaths, std::set<std::string>(), &options, errout);
+            addFiles(scanned, false, NULL);
+        }
+    }
+}
+//---------------------------------------------------------------------------
+
+bool IncludeGraph::load(const std::string &filename)
+{
+    std::ifstream fin(filename.c_str());
+    std::string line;
+    if (!std::getline(fin, line) || line != graphMagic)
+        return false;
+
+    files.clear();
+    File *file = NULL;
+    while (std::getline(fin, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream istr(line);
+        std::string field;
+        while (std::getline(istr, field, '\t'))
+            fields.push_back(field);
+
+        if (fields.size() == 4 && (fields[0] == "S" || fields[0] == "H"))
+        {
+            file = &files[fields[1]];
+            file->source = bool(fields[0] == "S");
+            file->bytes = std::atoi(fields[2].c_str());
+            file->tokens = std::atoi(fields[3].c_str());
+        }
+        else if (file && fields.size() == 5 && fields[0] == "I")
+        {
+            Include include;
+            include.linenr = std::atoi(fields[1].c_str());
+            include.header = fields[2];
+            include.path = fields[3];
+            include.unneeded = bool(fields[4] == "1");
+            file->includes.push_back(include);
+        }
+        else
+        {
+            files.clear();
+            return false;
+        }
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+
+bool IncludeGraph::save(const std::string &filename) const
+{
+    std::ofstream fout(filename.c_str());
+    if (!fout.is_open())
+        return false;
+
+    fout << graphMagic << "\n";
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        fout << (it->second.source ? "S" : "H") << "\t" << it->first
+             << "\t" << it->second.bytes << "\t" << it->second.tokens << "\n";
+        for (std::vector<Include>::const_iterator include = it->second.includes.begin(); include != it->second.includes.end(); ++include)
+            fout << "I\t" << include->linenr << "\t" << include->header << "\t" << include->path
+                 << "\t" << (include->unneeded ? "1" : "0") << "\n";
+    }
+    return fout.good();
+}
+//---------------------------------------------------------------------------
+
+std::vector<std::string> IncludeGraph::find(const std::string &name) const
+{
+    std::vector<std::string> paths;
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        const std::string &path = it->first;
+        if (path == name ||
+            (path.size() > name.size() &&
+             path.compare(path.size() - name.size(), name.size(), name) == 0 &&
+             (path[path.size() - name.size() - 1] == '/' || path[path.size() - name.size() - 1] == '\\')))
+            paths.push_back(path);
+    }
+    return paths;
+}
+//---------------------------------------------------------------------------
+
+std::vector<std::string> IncludeGraph::whoIncludes(const std::string &path, bool transitive) const
+{
+    // Reverse edges..
+    std::map<std::string, std::vector<std::string> > includedBy;
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        for (std::vector<Include>::const_iterator include = it->second.includes.begin(); include != it->second.includes.end(); ++include)
+        {
+            if (!include->path.empty())
+                includedBy[include->path].push_back(it->first);
+        }
+    }
+
+    std::set<std::string> result;
+    std::vector<std::string> todo(1, path);
+    while (!todo.empty())
+    {
+        const std::string file(todo.back());
+        todo.pop_back();
+
+        const std::vector<std::string> &includers = includedBy[file];
+        for (unsigned int i = 0; i < includers.size(); ++i)
+        {
+            if (result.insert(includers[i]).second && transitive)
+                todo.push_back(includers[i]);
+        }
+    }
+    result.erase(path);
+
+    return std::vector<std::string>(result.begin(), result.end());
+}
+//---------------------------------------------------------------------------
+
+std::vector<std::string> IncludeGraph::dependencies(const std::string &path) const
+{
+    std::set<std::string> result;
+    std::vector<std::string> todo(1, path);
+    while (!todo.empty())
+    {
+        const std::string file(todo.back());
+        todo.pop_back();
+
+        const std::map<std::string, File>::const_iterator it = files.find(file);
+        if (it == files.end())
+            continue;
+
+        for (std::vector<Include>::const_iterator include = it->second.includes.begin(); include != it->second.includes.end(); ++include)
+        {
+            if (!include->path.empty() && result.insert(include->path).second)
+                todo.push_back(include->path);
+        }
+    }
+    result.erase(path);
+
+    return std::vector<std::string>(result.begin(), result.end());
+}
+//---------------------------------------------------------------------------
+
+std::vector<std::string> IncludeGraph::affectedFiles(const std::vector<std::string> &filenames,
+                                                    const std::vector<std::string> &changed,
+                                                    unsigned int &matched) const
+{
+    std::set<std::string> changedPaths;
+    for (unsigned int i = 0; i < changed.size(); ++i)
+        changedPaths.insert(FileLister::absolutePath(changed[i]));
+
+    // The changed files and the files that include them..
+    std::set<std::string> known;
+    std::set<std::string> matchedPaths;
+    std::set<std::string> affected(changedPaths);
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        const std::string path(FileLister::absolutePath(it->first));
+        known.insert(path);
+        if (changedPaths.find(path) == changedPaths.end())
+            continue;
+
+        matchedPaths.insert(path);
+        const std::vector<std::string> includers(whoIncludes(it->first, true));
+        for (unsigned int i = 0; i < includers.size(); ++i)
+            affected.insert(FileLister::absolutePath(includers[i]));
+    }
+
+    // Files that are not in the graph are new, their includes are unknown..
+    std::vector<std::string> result;
+    for (unsigned int i = 0; i < filenames.size(); ++i)
+    {
+        const std::string path(FileLister::absolutePath(filenames[i]));
+        if (changedPaths.find(path) != changedPaths.end())
+            matchedPaths.insert(path);
+        if (affected.find(path) != affected.end() || known.find(path) == known.end())
+            result.push_back(filenames[i]);
+    }
+
+    matched = matchedPaths.size();
+    return result;
+}
+//---------------------------------------------------------------------------
+
+static bool heavier(const IncludeGraph::HeaderWeight &weight1, const IncludeGraph::HeaderWeight &weight2)
+{
+    if (weight1.totalTokens != weight2.totalTokens)
+        return weight1.totalTokens > weight2.totalTokens;
+    return weight1.path < weight2.path;
+}
+
+std::vector<IncludeGraph::HeaderWeight> IncludeGraph::headerWeights() const
+{
+    std::map<std::string, HeaderWeight> weights;
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        if (!it->second.source)
+            continue;
+
+        const std::vector<std::string> headers(dependencies(it->first));
+        for (unsigned int i = 0; i < headers.size(); ++i)
+        {
+            HeaderWeight &weight = weights[headers[i]];
+            if (weight.path.empty())
+            {
+                weight.path = headers[i];
+                weight.directIncluders = weight.includers = 0;
+            }
+            ++weight.includers;
+        }
+
+        std::set<std::string> direct;
+        for (std::vector<Include>::const_iterator include = it->second.includes.begin(); include != it->second.includes.end(); ++include)
+        {
+            if (!include->path.empty() && include->path != it->first && direct.insert(include->path).second)
+                ++weights[include->path].directIncluders;
+        }
+    }
+
+    std::vector<HeaderWeight> result;
+    for (std::map<std::string, HeaderWeight>::iterator it = weights.begin(); it != weights.end(); ++it)
+    {
+        HeaderWeight &weight = it->second;
+        const std::map<std::string, File>::const_iterator file = files.find(weight.path);
+        weight.tokens = (file == files.end()) ? 0 : file->second.tokens;
+
+        // The closure of the header..
+        const std::vector<std::string> closure(dependencies(weight.path));
+        weight.closureFiles = 1 + closure.size();
+        weight.closureTokens = weight.tokens;
+        for (unsigned int i = 0; i < closure.size(); ++i)
+        {
+            const std::map<std::string, File>::const_iterator dependency = files.find(closure[i]);
+            if (dependency != files.end())
+                weight.closureTokens += dependency->second.tokens;
+        }
+        weight.totalTokens = weight.includers * weight.closureTokens;
+        result.push_back(weight);
+    }
+
+    std::sort(result.begin(), result.end(), heavier);
+    return result;
+}
+//---------------------------------------------------------------------------
+
+// Directory of a file, "." if there is none
+static std::string directoryOf(const std::string &path)
+{
+    const std::string::size_type pos = path.find_last_of("/\\");
+    return (pos == std::string::npos) ? std::string(".") : path.substr(0, pos);
+}
+
+std::vector<IncludeGraph::PrecompiledHeader> IncludeGraph::precompiledHeaders(const std::map<std::string, unsigned int> &changes,
+                                                                              unsigned int maxChanges, unsigned int minShare) const
+{
+    // Source files in each directory and the files that are included as system headers..
+    std::map<std::string, std::vector<std::string> > directories;
+    std::set<std::string> systemHeaders;
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        if (it->second.source)
+            directories[directoryOf(it->first)].push_back(it->first);
+        for (std::vector<Include>::const_iterator include = it->second.includes.begin(); include != it->second.includes.end(); ++include)
+        {
+            if (include->header[0] == '<' && !include->path.empty())
+                systemHeaders.insert(include->path);
+        }
+    }
+
+    // The closure of each header, and are it and the files it includes stable?
+    std::map<std::string, std::vector<std::string> > closures;
+    std::map<std::string, bool> stable;
+    std::map<std::string, unsigned long> closureTokens;
+
+    std::vector<PrecompiledHeader> result;
+    for (std::map<std::string, std::vector<std::string> >::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        const std::vector<std::string> &sources = dir->second;
+        if (sources.size() < 2)
+            continue;
+
+        // How many source files include each header, and the tokens of the
+        // source files with the files they include..
+        std::map<std::string, unsigned int> includers;
+        std::vector< std::set<std::string> > included(sources.size());
+        unsigned long sourceTokens = 0;
+        for (unsigned int i = 0; i < sources.size(); ++i)
+        {
+            const std::vector<std::string> headers(dependencies(sources[i]));
+            included[i].insert(headers.begin(), headers.end());
+            sourceTokens += files.find(sources[i])->second.tokens;
+            for (unsigned int k = 0; k < headers.size(); ++k)
+            {
+                ++includers[headers[k]];
+                const std::map<std::string, File>::const_iterator file = files.find(headers[k]);
+                if (file != files.end())
+                    sourceTokens += file->second.tokens;
+            }
+        }
+
+        // Headers that most source files include, that are stable and that
+        // cost a share of the average source file..
+        std::vector<std::string> candidates;
+        for (std::map<std::string, unsigned int>::const_iterator it = includers.begin(); it != includers.end(); ++it)
+        {
+            if (2 * it->second < sources.size())
+                continue;
+
+            const std::string &header = it->first;
+            if (closures.find(header) == closures.end())
+            {
+                std::vector<std::string> &closure = closures[header];
+                closure = dependencies(header);
+                closure.push_back(header);
+
+                bool isStable = true;
+                unsigned long tokens = 0;
+                for (unsigned int k = 0; k < closure.size(); ++k)
+                {
+                    const std::map<std::string, unsigned int>::const_iterator changed = changes.find(closure[k]);
+                    if (changed != changes.end() && changed->second > maxChanges && !systemHeaders.count(closure[k]))
+                        isStable = false;
+                    const std::map<std::string, File>::const_iterator file = files.find(closure[k]);
+                    if (file != files.end())
+                        tokens += file->second.tokens;
+                }
+                stable[header] = isStable;
+                closureTokens[header] = tokens;
+            }
+            if (stable[header] && 100 * closureTokens[header] * sources.size() >= minShare * sourceTokens)
+                candidates.push_back(header);
+        }
+
+        // Headers that are included by other candidates are precompiled
+        // anyway. Of headers that include each other the first is kept.
+        std::set<std::string> precompiled;
+        std::vector< std::pair<unsigned long, std::string> > order;
+        for (unsigned int i = 0; i < candidates.size(); ++i)
+        {
+            const std::vector<std::string> &closure = closures[candidates[i]];
+            bool includedByOther = false;
+            for (unsigned int k = 0; k < candidates.size() && !includedByOther; ++k)
+            {
+                const std::vector<std::string> &other = closures[candidates[k]];
+                includedByOther = bool(k != i &&
+                                       std::find(other.begin(), other.end(), candidates[i]) != other.end() &&
+                                       (k < i || std::find(closure.begin(), closure.end(), candidates[k]) == closure.end()));
+            }
+            if (includedByOther)
+                continue;
+
+            precompiled.insert(closure.begin(), closure.end());
+            order.push_back(std::make_pair(~0UL - includers[candidates[i]] * closureTokens[candidates[i]], candidates[i]));
+        }
+        if (order.empty())
+            continue;
+        std::sort(order.begin(), order.end());
+
+        PrecompiledHeader pch;
+        pch.directory = dir->first;
+        pch.sources = sources.size();
+        for (unsigned int i = 0; i < order.size(); ++i)
+        {
+            pch.headers.push_back(order[i].second);
+            pch.includers.push_back(includers[order[i].second]);
+            pch.tokens.push_back(closureTokens[order[i].second]);
+        }
+
+        // The precompiled tokens that the source files include..
+        unsigned long saved = 0;
+        for (unsigned int i = 0; i < sources.size(); ++i)
+        {
+            for (std::set<std::string>::const_iterator it = precompiled.begin(); it != precompiled.end(); ++it)
+            {
+                const std::map<std::string, File>::const_iterator file = files.find(*it);
+                if (included[i].count(*it) && file != files.end())
+                    saved += file->second.tokens;
+            }
+        }
+        pch.savedTokens = saved / sources.size();
+        result.push_back(pch);
+    }
+    return result;
+}
+//---------------------------------------------------------------------------
+
+static bool moreSaved(const IncludeGraph::DeadHeader &header1, const IncludeGraph::DeadHeader &header2)
+{
+    if (header1.savedTokens != header2.savedTokens)
+        return header1.savedTokens > header2.savedTokens;
+    return header1.path < header2.path;
+}
+
+std::vector<IncludeGraph::DeadHeader> IncludeGraph::deadHeaders(const std::vector<std::string> &headers) const
+{
+    // The includes of each file, and the files that are included as system headers..
+    std::map<std::string, unsigned int> includeSites;
+    std::set<std::string> neededHeaders;
+    std::set<std::string> systemHeaders;
+    std::set<std::string> candidates(headers.begin(), headers.end());
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        if (!it->second.source)
+            candidates.insert(it->first);
+        for (std::vector<Include>::const_iterator include = it->second.includes.begin(); include != it->second.includes.end(); ++include)
+        {
+            if (include->path.empty())
+                continue;
+            ++includeSites[include->path];
+            if (!include->unneeded)
+                neededHeaders.insert(include->path);
+            if (include->header[0] == '<')
+                systemHeaders.insert(include->path);
+        }
+    }
+
+    std::vector<DeadHeader> result;
+    for (std::set<std::string>::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+    {
+        const std::map<std::string, File>::const_iterator file = files.find(*it);
+        if (neededHeaders.count(*it) || systemHeaders.count(*it) || (file != files.end() && file->second.source))
+            continue;
+
+        DeadHeader header;
+        header.path = *it;
+        header.includeSites = includeSites[*it];
+        header.includers = 0;
+        const std::vector<std::string> includers(whoIncludes(*it, true));
+        for (unsigned int i = 0; i < includers.size(); ++i)
+        {
+            const std::map<std::string, File>::const_iterator includer = files.find(includers[i]);
+            if (includer != files.end() && includer->second.source)
+                ++header.includers;
+        }
+        header.tokens = (file == files.end()) ? 0 : file->second.tokens;
+        header.savedTokens = (unsigned long)header.includers * header.tokens;
+        result.push_back(header);
+    }
+
+    std::sort(result.begin(), result.end(), moreSaved);
+    return result;
+}
+//---------------------------------------------------------------------------
+
+// Strongly connected components of the include graph (Tarjan). The
+// components are found in reverse topological order: a component is
+// added after the components it includes.
+class IncludeComponents
+{
+public:
+    IncludeComponents(const std::map<std::string, IncludeGraph::File> &graphFiles)
+        : files(graphFiles), counter(0)
+    {
+        for (std::map<std::string, IncludeGraph::File>::const_iterator it = files.begin(); it != files.end(); ++it)
+        {
+            if (index.find(it->first) == index.end())
+                visit(it->first);
+        }
+    }
+
+    std::vector< std::vector<std::string> > components;
+    std::map<std::string, unsigned int> componentOf;
+
+private:
+    void visit(const std::string &path)
+    {
+        index[path] = lowlink[path] = counter++;
+        stack.push_back(path);
+        onStack.insert(path);
+
+        const std::map<std::string, IncludeGraph::File>::const_iterator file = files.find(path);
+        if (file != files.end())
+        {
+            const std::vector<IncludeGraph::Include> &includes = file->second.includes;
+            for (std::vector<IncludeGraph::Include>::const_iterator include = includes.begin(); include != includes.end(); ++include)
+            {
+                if (include->path.empty())
+                    continue;
+                if (index.find(include->path) == index.end())
+                {
+                    visit(include->path);
+                    lowlink[path] = std::min(lowlink[path], lowlink[include->path]);
+                }
+                else if (onStack.find(include->path) != onStack.end())
+                {
+                    lowlink[path] = std::min(lowlink[path], index[include->path]);
+                }
+            }
+        }
+
+        if (lowlink[path] != index[path])
+            return;
+
+        std::vector<std::string> component;
+        std::string member;
+        do
+        {
+            member = stack.back();
+            stack.pop_back();
+            onStack.erase(member);
+            componentOf[member] = components.size();
+            component.push_back(member);
+        }
+        while (member != path);
+        std::sort(component.begin(), component.end());
+        components.push_back(component);
+    }
+
+    const std::map<std::string, IncludeGraph::File> &files;
+    std::map<std::string, unsigned int> index;
+    std::map<std::string, unsigned int> lowlink;
+    std::vector<std::string> stack;
+    std::set<std::string> onStack;
+    unsigned int counter;
+};
+//---------------------------------------------------------------------------
+
+std::map<std::string, IncludeGraph::FileMetrics> IncludeGraph::metrics() const
+{
+    std::map<std::string, FileMetrics> result;
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        std::set<std::string> included;
+        for (std::vector<Include>::const_iterator include = it->second.includes.begin(); include != it->second.includes.end(); ++include)
+        {
+            if (!include->path.empty() && include->path != it->first && included.insert(include->path).second)
+                ++result[include->path].fanIn;
+        }
+        result[it->first].fanOut = included.size();
+    }
+
+    // The depth of a component is the longest chain to the components it
+    // includes. They are handled before it..
+    const IncludeComponents graph(files);
+    std::vector<unsigned int> depth(graph.components.size(), 0);
+    for (unsigned int c = 0; c < graph.components.size(); ++c)
+    {
+        const std::vector<std::string> &component = graph.components[c];
+        for (unsigned int i = 0; i < component.size(); ++i)
+        {
+            const std::map<std::string, File>::const_iterator file = files.find(component[i]);
+            if (file == files.end())
+                continue;
+            for (std::vector<Include>::const_iterator include = file->second.includes.begin(); include != file->second.includes.end(); ++include)
+            {
+                if (include->path.empty())
+                    continue;
+                const unsigned int other = graph.componentOf.find(include->path)->second;
+                if (other != c)
+                    depth[c] = std::max(depth[c], depth[other] + 1);
+            }
+        }
+        for (unsigned int i = 0; i < component.size(); ++i)
+            result[component[i]].depth = depth[c];
+    }
+
+    return result;
+}
+//---------------------------------------------------------------------------
+
+std::vector< std::vector<std::string> > IncludeGraph::cycles() const
+{
+    const IncludeComponents graph(files);
+
+    std::vector< std::vector<std::string> > result;
+    for (unsigned int c = 0; c < graph.components.size(); ++c)
+    {
+        const std::vector<std::string> &component = graph.components[c];
+        bool cycle = (component.size() > 1);
+        const std::map<std::string, File>::const_iterator file = files.find(component[0]);
+        if (!cycle && file != files.end())
+        {
+            // A file that includes itself..
+            for (std::vector<Include>::const_iterator include = file->second.includes.begin(); include != file->second.includes.end(); ++include)
+                cycle |= (include->path == component[0]);
+        }
+        if (cycle)
+            result.push_back(component);
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+//---------------------------------------------------------------------------
+
+// Escape a string for the dot and json formats
+static std::string escaped(const std::string &str)
+{
+    std::string result;
+    for (std::string::size_type pos = 0; pos < str.size(); ++pos)
+    {
+        const unsigned char c = str[pos];
+        if (c == '\"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (c < 0x20)
+        {
+            char buf[8];
+            std::sprintf(buf, "\\u%04x", c);
+            result += buf;
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    return result;
+}
+
+// Escape and quote a string
+static std::string quoted(const std::string &str)
+{
+    return "\"" + escaped(str) + "\"";
+}
+
+void IncludeGraph::writeDot(std::ostream &out) const
+{
+    const std::map<std::string, FileMetrics> fileMetrics(metrics());
+
+    out << "digraph includes {\n";
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        const FileMetrics &m = fileMetrics.find(it->first)->second;
+        out << "    " << quoted(it->first) << " [label=\"" << escaped(it->first) << "\\n"
+            << it->second.bytes << " bytes, " << it->second.tokens << " tokens\\n"
+            << "depth " << m.depth << ", fan-in " << m.fanIn << ", fan-out " << m.fanOut
+            << "\"" << (it->second.source ? ", shape=box" : "") << "];\n";
+    }
+
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        for (std::vector<Include>::const_iterator include = it->second.includes.begin(); include != it->second.includes.end(); ++include)
+        {
+            if (include->path.empty())
+                continue;
+            out << "    " << quoted(it->first) << " -> " << quoted(include->path)
+                << " [label=\"" << include->linenr << "\""
+                << (include->unneeded ? ", style=dashed, color=red" : "") << "];\n";
+        }
+    }
+
+    out << "}\n";
+}
+//---------------------------------------------------------------------------
+
+void IncludeGraph::writeJson(std::ostream &out) const
+{
+    const std::map<std::string, FileMetrics> fileMetrics(metrics());
+
+    out << "{\n  \"files\": [";
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        const FileMetrics &m = fileMetrics.find(it->first)->second;
+        out << (it == files.begin() ? "\n" : ",\n")
+            << "    {\"path\": " << quoted(it->first)
+            << ", \"source\": " << (it->second.source ? "true" : "false")
+            << ", \"bytes\": " << it->second.bytes
+            << ", \"tokens\": " << it->second.tokens
+            << ", \"depth\": " << m.depth
+            << ", \"fanIn\": " << m.fanIn
+            << ", \"fanOut\": " << m.fanOut << "}";
+    }
+
+    out << "\n  ],\n  \"includes\": [";
+    bool first = true;
+    for (std::map<std::string, File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        for (std::vector<Include>::const_iterator include = it->second.includes.begin(); include != it->second.includes.end(); ++include)
+        {
+            out << (first ? "\n" : ",\n")
+                << "    {\"from\": " << quoted(it->first)
+                << ", \"line\": " << include->linenr
+                << ", \"header\": " << quoted(include->header)
+                << ", \"to\": " << (include->path.empty() ? std::string("null") : quoted(include->path))
+                << ", \"unneeded\": " << (include->unneeded ? "true" : "false") << "}";
+            first = false;
+        }
+    }
+
+    out << "\n  ],\n  \"cycles\": [";
+    const std::vector< std::vector<std::string> > fileCycles(cycles());
+    for (unsigned int c = 0; c < fileCycles.size(); ++c)
+    {
+        out << (c == 0 ? "\n    [" : ",\n    [");
+        for (unsigned int i = 0; i < fileCycles[c].size(); ++i)
+            out << (i == 0 ? "" : ", ") << quoted(fileCycles[c][i]);
+        out << "]";
+    }
+    out << "\n  ]\n}\n";
+}
+//---------------------------------------------------------------------------
+
@@ -0,0 +1,228 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+//---------------------------------------------------------------------------
+#ifndef includegraphH
+#define includegraphH
+//---------------------------------------------------------------------------
+
+#include "tokenize.h"
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * The include graph of a project: the #include directives of every file
+ * and the paths they are resolved to. The graph is collected from the
+ * tokenized files and can be saved to a file, so questions like "which
+ * source files include this header" can be answered without resolving
+ * the includes again.
+ */
+class IncludeGraph
+{
+public:
+    struct Include
+    {
+        Include() : linenr(0), unneeded(false)
+        { }
+
+        unsigned int linenr;
+        std::string header;   // header name as it is written, "<x.h>" for system includes
+        std::string path;     // path of the included file. Empty if it is not found
+        bool unneeded;        // is the include reported as not needed?
+    };
+
+    struct File
+    {
+        File() : source(false), bytes(0), tokens(0)
+        { }
+
+        bool source;                     // is the file a checked source file?
+        unsigned int bytes;
+        unsigned int tokens;             // 0 if the file was not tokenized
+        std::vector<Include> includes;
+    };
+
+    /** How much a header costs the source files that include it */
+    struct HeaderWeight
+    {
+        std::string path;
+        unsigned int directIncluders;    // source files that include the header directly
+        unsigned int includers;          // source files that include the header directly or indirectly
+        unsigned int tokens;             // tokens of the header itself
+        unsigned int closureFiles;       // the header and the files it includes directly or indirectly
+        unsigned long closureTokens;     // tokens of the closure files
+        unsigned long totalTokens;       // includers * closureTokens
+    };
+
+    /** Headers that should be precompiled for the source files in a directory */
+    struct PrecompiledHeader
+    {
+        std::string directory;
+        unsigned int sources;                  // source files in the directory
+        std::vector<std::string> headers;      // the headers, the most used first
+        std::vector<unsigned int> includers;   // source files that include each header
+        std::vector<unsigned long> tokens;     // closure tokens of each header
+        unsigned long savedTokens;             // estimated tokens saved per source file
+    };
+
+    /** A header that no source file needs */
+    struct DeadHeader
+    {
+        std::string path;
+        unsigned int includeSites;   // includes of the header, all of them are not needed
+        unsigned int includers;      // source files that include the header directly or indirectly
+        unsigned int tokens;         // tokens of the header
+        unsigned long savedTokens;   // includers * tokens
+    };
+
+    /** Include metrics of a file */
+    struct FileMetrics
+    {
+        FileMetrics() : depth(0), fanIn(0), fanOut(0)
+        { }
+
+        unsigned int depth;    // longest chain of includes from the file, includes in cycles are not followed
+        unsigned int fanIn;    // files that include the file
+        unsigned int fanOut;   // files that the file includes
+    };
+
+    /**
+     * add the includes of a tokenized source file. Files that are known
+     * already are replaced.
+     * @param tokenizer tokenized source file
+     * @param unneededIncludes "file:line" of the includes that are reported as not needed
+     */
+    void add(const Tokenizer &tokenizer, const std::set<std::string> *unneededIncludes = NULL);
+
+    /**
+     * load a graph file
+     * @return false if the file is missing or invalid
+     */
+    bool load(const std::string &filename);
+
+    /**
+     * write a graph file
+     * @return false if the file could not be written
+     */
+    bool save(const std::string &filename) const;
+
+    /**
+     * find the files that match a name. The name matches a path if it is
+     * the path or the last components of the path.
+     */
+    std::vector<std::string> find(const std::string &name) const;
+
+    /**
+     * get the files that include a file
+     * @param path path of the file
+     * @param transitive also get the files that include it indirectly
+     * @return the paths of the including files, sorted
+     */
+    std::vector<std::string> whoIncludes(const std::string &path, bool transitive) const;
+
+    /**
+     * get the files that a file includes directly or indirectly
+     * @param path path of the file
+     * @return the paths of the included files, sorted
+     */
+    std::vector<std::string> dependencies(const std::string &path) const;
+
+    /**
+     * get the files that are affected by changed files: the changed files
+     * and the files that include them. The paths are compared as absolute
+     * paths, so they may be relative to different directories.
+     * @param filenames the files that can be affected
+     * @param changed the changed files
+     * @param matched the number of changed files that are in the graph
+     *                or in filenames
+     * @return the affected files of filenames. The files that are not in
+     *         the graph are new, they are affected too.
+     */
+    std::vector<std::string> affectedFiles(const std::vector<std::string> &filenames,
+                                           const std::vector<std::string> &changed,
+                                           unsigned int &matched) const;
+
+    /**
+     * get the weights of the headers that are included by the source
+     * files in the graph
+     * @return the weights, the heaviest total first
+     */
+    std::vector<HeaderWeight> headerWeights() const;
+
+    /**
+     * recommend precompiled headers for the source files in each directory:
+     * the headers that at least half of the source files include directly
+     * or indirectly, that don't change often and that are costly enough.
+     * Headers that are included by the recommended headers are not listed.
+     * @param changes the number of recent changes of the files
+     * @param maxChanges files that have changed more often are not
+     *                   precompiled, and neither are the headers that include them.
+     *                   System headers are expected to be stable.
+     * @param minShare the tokens of a header and the files it includes must be
+     *                 at least this percentage of the average tokens of the
+     *                 source files in the directory
+     */
+    std::vector<PrecompiledHeader> precompiledHeaders(const std::map<std::string, unsigned int> &changes,
+                                                      unsigned int maxChanges, unsigned int minShare) const;
+
+    /**
+     * get the headers that no source file needs: every include of them is
+     * reported as not needed, or they are not included at all. Headers
+     * that are included as system headers are not listed.
+     * @param headers the headers of the project. The headers in the
+     *                graph are checked too.
+     * @return the dead headers, the most saved tokens first
+     */
+    std::vector<DeadHeader> deadHeaders(const std::vector<std::string> &headers) const;
+
+    /** get the include metrics of every file */
+    std::map<std::string, FileMetrics> metrics() const;
+
+    /** get the include cycles: groups of files that include each other, sorted */
+    std::vector< std::vector<std::string> > cycles() const;
+
+    /** write the graph and the metrics in the graphviz dot format */
+    void writeDot(std::ostream &out) const;
+
+    /** write the graph and the metrics in json format */
+    void writeJson(std::ostream &out) const;
+
+    const std::map<std::string, File> &getFiles() const
+    {
+        return files;
+    }
+
+private:
+    /**
+     * add the files of a tokenizer and the files that are identical to them
+     * @param source is the first file a checked source file? Otherwise the
+     *               files that are in the graph already are kept
+     */
+    void addFiles(const Tokenizer &tokenizer, bool source, const std::set<std::string> *unneededIncludes);
+
+    std::map<std::string, File> files;
+};
+
+//---------------------------------------------------------------------------
+#endif
+
@@ -29,13 +29,28 @@
 
 #include "tokenize.h"   // <- Tokenizer
 
-#include "checkheaders.h"
+#include "check.h"
+
+#include "checkheaders.h"   // <- SummarizeHeaders, for --incremental
+
+#include "symbolcache.h"   // <- header symbols are shared between the checked files
+
+#include "includegraph.h"   // <- --include-graph
+
+#include "fixit.h"   // <- --fixit-diff, --fix
+
+#include "headerusage.h"   // <- --report=header-split
 
 #include "FileParser.h"   // <- File Parser when both skips and includes are specified in a file
 
+#include "commoncheck.h"   // <- reported errors are stored for --incremental
+
 #include <algorithm>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <cstdlib>
 #include <cstring>
 #include <set>
 
@@ -43,7 +58,35 @@
 
 static Options userOption;
 
-static void CheckFile(const char FileName[], const Options *pOptions, const std::vector<std::string> &includePaths, const std::set<std::string> &skipIncludes);
+// Symbols of the headers, shared between all checked files
+static SymbolCache symbolCache;
+
+// Includes in headers that have been checked. Each include is checked once
+static std::set<std::string> checkedIncludes;
+
+// Include graph of the checked files. Only collected when it is used
+static IncludeGraph includeGraph;
+static bool collectIncludeGraph = false;
+
+// "file:line" of the includes that are not needed. They are marked in the
+// include graph, so they are collected with it
+static std::set<std::string> unneededIncludes;
+
+// Used symbols of the headers. Only collected with --report=header-split
+static HeaderUsage headerUsage;
+static bool collectHeaderUsage = false;
+
+// Fixes for the reported errors. Only collected with --fixit-diff and --fix
+static FixIts fixIts;
+static bool collectFixIts = false;
+
+static void CheckFile(const char FileName[], const Options *pOptions, const std::vector<std::string> &includePaths, const std::set<std::string> &skipIncludes, std::ostream &errout);
+static void PrintSortedByCost(const std::string &errors);
+static void PrintHeaderWeights();
+static void PrintPrecompiledHeaders();
+static bool ExportGraph(const std::string &format, const std::string &filename);
+static void PrintDeadHeaders(const std::vector<std::string> &paths);
+static void PrintHeaderSplits();
 
 //---------------------------------------------------------------------------
 // Main function of checkheaders
@@ -54,6 +97,22 @@ int main(int argc, char* argv[])
     std::vector<std::string> filenames;
     std::vector<std::string> includePaths;
     std::set<std::string> skipIncludes;
+    std::string symbolDatabase;
+    bool compactDatabase = false;
+    std::string includeGraphFile;
+    std::string whoIncludes;
+    std::string deps;
+    bool transitive = false;
+    std::string changedSince;
+    bool sortByCost = false;
+    bool reportHeaderWeight = false;
+    bool reportPch = false;
+    bool reportDeadHeaders = false;
+    std::vector<std::string> paths;
+    std::string fixitDiff;
+    bool fix = false;
+    std::string exportFormat;
+    std::string exportFile;
 
     userOption.outputFormat = OUTPUT_FORMAT_NORMAL;
     userOption.Progress = true;
@@ -70,6 +129,130 @@ int main(int argc, char* argv[])
             userOption.Progress = false;
         }
 
+        else if (strcmp(argv[i], "--resolve-only") == 0)
+        {
+            userOption.ResolveOnly = true;
+        }
+
+        else if (strncmp(argv[i], "--enable=", 9) == 0)
+        {
+            std::istringstream names(argv[i] + 9);
+            std::string name;
+            while (std::getline(names, name, ','))
+            {
+                bool found = false;
+                for (std::list<const Check *>::const_iterator it = Check::instances().begin(); it != Check::instances().end(); ++it)
+                {
+                    if (name == "all" || name == (*it)->name())
+                    {
+                        userOption.EnabledChecks.insert((*it)->name());
+                        found = true;
+                    }
+                }
+                if (!found)
+                {
+                    std::cerr << "checkheaders: unknown check: '" << name << "'" << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        else if (strcmp(argv[i], "--incremental") == 0)
+        {
+            userOption.Incremental = true;
+        }
+
+        else if (strcmp(argv[i], "--include-graph") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            includeGraphFile = argv[i];
+        }
+
+        else if (strcmp(argv[i], "--who-includes") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            whoIncludes = argv[i];
+        }
+
+        else if (strcmp(argv[i], "--transitive") == 0)
+        {
+            transitive = true;
+        }
+
+        else if (strcmp(argv[i], "--deps") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            deps = argv[i];
+        }
+
+        else if (strcmp(argv[i], "--include-cost") == 0)
+        {
+            userOption.IncludeCost = true;
+        }
+
+        else if (strcmp(argv[i], "--sort=cost") == 0)
+        {
+            userOption.IncludeCost = true;
+            sortByCost = true;
+        }
+
+        else if (strcmp(argv[i], "--report=header-weight") == 0)
+        {
+            reportHeaderWeight = true;
+        }
+
+        else if (strcmp(argv[i], "--fixit-diff") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            fixitDiff = argv[i];
+            collectFixIts = true;
+        }
+
+        else if (strcmp(argv[i], "--fix") == 0)
+        {
+            fix = true;
+            collectFixIts = true;
+        }
+
+        else if (strcmp(argv[i], "--report=pch") == 0)
+        {
+            reportPch = true;
+        }
+
+        else if (strcmp(argv[i], "--report=header-split") == 0)
+        {
+            collectHeaderUsage = true;
+        }
+
+        else if (strcmp(argv[i], "--report=dead-headers") == 0)
+        {
+            reportDeadHeaders = true;
+        }
+
+        else if ((strcmp(argv[i], "--export-graph=dot") == 0 || strcmp(argv[i], "--export-graph=json") == 0) && (i + 1) < argc)
+        {
+            exportFormat = argv[i] + 15;
+            ++i;
+            exportFile = argv[i];
+        }
+
+        else if (strcmp(argv[i], "--changed-since") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            changedSince = argv[i];
+        }
+
+        else if (strcmp(argv[i], "--symbol-db") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            symbolDatabase = argv[i];
+        }
+
+        else if (strcmp(argv[i], "--compact-db") == 0)
+        {
+            compactDatabase = true;
+        }
+
         else if (strcmp(argv[i], "--skip") == 0 && (i + 1) < argc)
         {
             ++i;
@@ -139,6 +322,7 @@ int main(int argc, char* argv[])
         {
             unsigned int sz = filenames.size();
             FileLister::recursiveAddFiles(filenames, argv[i], true);
+            paths.push_back(argv[i]);
             if (sz == filenames.size())
             {
                 std::cerr << "checkheaders: file/path not found: '" << argv[i] << "'" << std::endl;
@@ -147,6 +331,41 @@ int main(int argc, char* argv[])
         }
     }
 
+    // Answer a query from the include graph..
+    if (!whoIncludes.empty() || !deps.empty())
+    {
+        if (includeGraphFile.empty())
+        {
+            std::cerr << "checkheaders: --who-includes and --deps require --include-graph" << std::endl;
+            return 1;
+        }
+        if (!includeGraph.load(includeGraphFile))
+        {
+            std::cerr << "checkheaders: failed to read include graph '" << includeGraphFile << "'" << std::endl;
+            return 1;
+        }
+
+        const std::string &name = whoIncludes.empty() ? deps : whoIncludes;
+        const std::vector<std::string> paths(includeGraph.find(name));
+        if (paths.empty())
+        {
+            std::cerr << "checkheaders: '" << name << "' is not in the include graph" << std::endl;
+            return 1;
+        }
+
+        std::set<std::string> result;
+        for (unsigned int i = 0; i < paths.size(); ++i)
+        {
+            const std::vector<std::string> files(whoIncludes.empty() ?
+                                                 includeGraph.dependencies(paths[i]) :
+                                                 includeGraph.whoIncludes(paths[i], transitive));
+            result.insert(files.begin(), files.end());
+        }
+        for (std::set<std::string>::const_iterator it = result.begin(); it != result.end(); ++it)
+            std::cout << *it << std::endl;
+        return 0;
+    }
+
     if (filenames.empty())
     {
         std::cout << "check headers in C/C++ code to detect unnecessary includes.\n"
@@ -157,7 +376,78 @@ int main(int argc, char* argv[])
                   << "Options:\n"
                   << "    -I <path>      Specify include path. It is only needed if\n"
                   << "                   you see 'Header not found' messages.\n"
+                  << "    --enable=<checks>  Enable additional checks. The checks are\n"
+                  << "                   given as a comma separated list:\n"
+                  << "                   implementation - implementation in headers\n"
+                  << "                   redundant      - includes that other needed\n"
+                  << "                                    includes include too\n"
+                  << "                   includeset     - cheaper sets of headers that\n"
+                  << "                                    provide the needed symbols\n"
+                  << "                   all            - all checks\n"
                   << "    --quiet        Keep informative message to minimum.\n"
+                  << "    --resolve-only Only check that all #include directives can be\n"
+                  << "                   resolved. The code is not analysed.\n"
+                  << "    --symbol-db <file>  Store the symbols of the headers in a database\n"
+                  << "                   file. Headers that have not changed are not\n"
+                  << "                   parsed again in the next run.\n"
+                  << "    --compact-db   Only keep the headers used in this run in the\n"
+                  << "                   --symbol-db database.\n"
+                  << "    --include-graph <file>  Save the include graph of the checked\n"
+                  << "                   files in a file. The graph is used by the\n"
+                  << "                   queries below.\n"
+                  << "    --who-includes <file>  Print the files that include the file\n"
+                  << "                   according to --include-graph. Nothing is checked.\n"
+                  << "    --transitive   Also print the files that include the file\n"
+                  << "                   indirectly with --who-includes.\n"
+                  << "    --deps <file>  Print the files that the file includes directly\n"
+                  << "                   or indirectly according to --include-graph.\n"
+                  << "    --include-cost Show what each unneeded include costs: the files,\n"
+                  << "                   bytes and tokens that only come through it.\n"
+                  << "    --sort=cost    Show the errors sorted by the cost of the include,\n"
+                  << "                   the most expensive first. Implies --include-cost.\n"
+                  << "    --report=header-weight  Print how much each header costs the\n"
+                  << "                   checked files: the files that include it, its\n"
+                  << "                   tokens and the tokens of the files it includes.\n"
+                  << "                   With --include-graph the files of earlier runs\n"
+                  << "                   are counted too.\n"
+                  << "    --fixit-diff <file>  Write a unified diff that removes the\n"
+                  << "                   unneeded includes or replaces them by the forward\n"
+                  << "                   declarations that are needed. Apply it with\n"
+                  << "                   \"patch -p0\".\n"
+                  << "    --export-graph=<format> <file>  Write the include graph of\n"
+                  << "                   the checked files in the \"dot\" or \"json\"\n"
+                  << "                   format: the size and tokens, include depth,\n"
+                  << "                   fan-in and fan-out of each file and the includes\n"
+                  << "                   with their line, unneeded includes are marked.\n"
+                  << "                   The include cycles are printed.\n"
+                  << "    --fix          Remove the unneeded includes from the files, or\n"
+                  << "                   replace them by forward declarations. The files\n"
+                  << "                   that include a changed file are checked again and\n"
+                  << "                   a change is undone if an include is not found or\n"
+                  << "                   a needed symbol is not declared after it.\n"
+                  << "    --report=pch   Recommend precompiled headers for the checked\n"
+                  << "                   files in each directory: the headers that most\n"
+                  << "                   of the files include, that the latest git\n"
+                  << "                   commits have seldom changed and that cost at\n"
+                  << "                   least 5% of the tokens of the files.\n"
+                  << "    --report=header-split  Suggest splitting the headers whose\n"
+                  << "                   symbols are used in separate groups: the files\n"
+                  << "                   that include the header use symbols of only one\n"
+                  << "                   group. The tokens saved are estimated.\n"
+                  << "    --report=dead-headers  Print the headers that none of the\n"
+                  << "                   checked files needs: every include of them is\n"
+                  << "                   not needed, or the headers under the checked\n"
+                  << "                   paths are not included at all. With\n"
+                  << "                   --include-graph the files of earlier runs are\n"
+                  << "                   counted too.\n"
+                  << "    --changed-since <rev>  Only check the files that are changed\n"
+                  << "                   since the git revision or that include a\n"
+                  << "                   changed header. Requires --include-graph.\n"
+                  << "    --incremental  Reuse the results of the previous run for source\n"
+                  << "                   files whose headers only changed internally. The\n"
+                  << "                   results are stored in the --symbol-db database.\n"
+                  << "                   It can't be used with --report, --export-graph,\n"
+                  << "                   --fix or --fixit-diff.\n"
                   << "    --skip <file>  Skip header. Matching #include directives in\n"
                   << "                   the source code will be skipped.\n"
                   << "    --skip-all     Skip all missing include files.\n"
@@ -178,38 +468,291 @@ int main(int argc, char* argv[])
         return 0;
     }
 
+    // The include graph is updated with the checked files
+    if (!includeGraphFile.empty())
+        includeGraph.load(includeGraphFile);
+    collectIncludeGraph = !includeGraphFile.empty() || reportHeaderWeight || reportPch || reportDeadHeaders || fix || !exportFile.empty();
+
+    if (userOption.Incremental && symbolDatabase.empty())
+    {
+        std::cerr << "checkheaders: --incremental requires --symbol-db" << std::endl;
+        return 1;
+    }
+
+    // The reused results don't have the data of the reports and fixes
+    if (userOption.Incremental && (reportHeaderWeight || reportPch || reportDeadHeaders || collectHeaderUsage ||
+                                   !exportFile.empty() || fix || !fixitDiff.empty()))
+    {
+        std::cerr << "checkheaders: --incremental can't be used with --report, --export-graph, --fix or --fixit-diff" << std::endl;
+        return 1;
+    }
+
     std::sort(filenames.begin(), filenames.end());
 
+    // Only check the files that are affected by changes..
+    if (!changedSince.empty())
+    {
+        if (includeGraphFile.empty())
+        {
+            std::cerr << "checkheaders: --changed-since requires --include-graph" << std::endl;
+            return 1;
+        }
+
+        std::vector<std::string> changed;
+        if (!FileLister::changedFiles(changed, changedSince))
+        {
+            std::cerr << "checkheaders: failed to get the files changed since '" << changedSince << "' from git" << std::endl;
+            return 1;
+        }
+
+        const unsigned int total = filenames.size();
+        unsigned int matched = 0;
+        filenames = includeGraph.affectedFiles(filenames, changed, matched);
+        if (!changed.empty() && matched == 0)
+        {
+            std::cerr << "checkheaders: warning: none of the " << changed.size() << " files changed since '" << changedSince
+                      << "' is checked or in the include graph" << std::endl;
+        }
+        if (userOption.Progress)
+            std::cout << "progress: " << filenames.size() << " of " << total << " files are affected by the changes" << std::endl;
+    }
+
+    // Load symbols of headers that were checked in a previous run
+    if (!symbolDatabase.empty())
+        symbolCache.load(symbolDatabase);
+
     if (userOption.outputFormat == OUTPUT_FORMAT_XML)
     {
         std::cerr << "<?xml version=\"1.0\"?>\n"
                   << "<results>\n";
     }
 
+    // The errors are written when all files are checked if they are sorted
+    std::ostringstream sortedErrors;
+    std::ostream &errout = sortByCost ? static_cast<std::ostream &>(sortedErrors) : std::cerr;
+
     for (unsigned int c = 0; c < filenames.size(); c++)
     {
-        CheckFile(filenames[c].c_str(), &userOption, includePaths, skipIncludes);
+        CheckFile(filenames[c].c_str(), &userOption, includePaths, skipIncludes, errout);
     }
 
+    if (sortByCost)
+        PrintSortedByCost(sortedErrors.str());
+
     if (userOption.outputFormat == OUTPUT_FORMAT_XML)
         std::cerr << "</results>\n";
 
+    if (!symbolDatabase.empty() && !symbolCache.save(symbolDatabase, compactDatabase))
+    {
+        std::cerr << "checkheaders: failed to write '" << symbolDatabase << "'" << std::endl;
+        return 1;
+    }
+
+    if (reportHeaderWeight)
+        PrintHeaderWeights();
+
+    if (reportPch)
+        PrintPrecompiledHeaders();
+
+    if (reportDeadHeaders)
+        PrintDeadHeaders(paths);
+
+    if (collectHeaderUsage)
+        PrintHeaderSplits();
+
+    if (!fixitDiff.empty())
+    {
+        std::ofstream fout(fixitDiff.c_str(), std::ios::binary);
+        if (!fixIts.writeDiff(fout, std::cerr) || !fout.good())
+        {
+            std::cerr << "checkheaders: failed to write '" << fixitDiff << "'" << std::endl;
+            return 1;
+        }
+    }
+
+    if (fix && !fixIts.fix(includeGraph, filenames, includePaths, skipIncludes, std::cout))
+        return 1;
+
+    if (!exportFile.empty() && !ExportGraph(exportFormat, exportFile))
+    {
+        std::cerr << "checkheaders: failed to write '" << exportFile << "'" << std::endl;
+        return 1;
+    }
+
+    if (!includeGraphFile.empty() && !includeGraph.save(includeGraphFile))
+    {
+        std::cerr << "checkheaders: failed to write '" << includeGraphFile << "'" << std::endl;
+        return 1;
+    }
+
     return 0;
 }
 
+//---------------------------------------------------------------------------
+// Paths of the same file from git, the command line and the include graph
+// can be relative to different directories. They are compared as absolute
+// paths.
+//---------------------------------------------------------------------------
+
+static std::string comparablePath(const std::string &path)
+{
+    return FileLister::absolutePath(path);
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// Incremental checking. The results of a source file depend on the
+// contents of the source file, on the interfaces of the headers it includes
+// and on the contents of the headers whose includes were checked with it.
+//---------------------------------------------------------------------------
+
+// Number of includes in the header that have been checked in this run
+static unsigned int countCheckedIncludes(const std::string &header)
+{
+    const std::string prefix(header + ":");
+    unsigned int count = 0;
+    for (std::set<std::string>::const_iterator it = checkedIncludes.lower_bound(prefix);
+         it != checkedIncludes.end() && it->compare(0, prefix.size(), prefix) == 0; ++it)
+        ++count;
+    return count;
+}
+
+// Reuse the results of the previous run. Returns false if the file must be checked.
+static bool ReuseResults(const char FileName[], const Options *pOptions,
+                         const std::vector<std::string> &includePaths,
+                         const std::set<std::string> &skipIncludes,
+                         std::ostream &errout)
+{
+    const SourceResults *results = symbolCache.findResults(FileName);
+    if (!results)
+        return false;
+
+    // The headers that were checked with earlier source files must have
+    // been checked in this run too..
+    for (unsigned int i = 0; i < results->otherHeaders.size(); ++i)
+    {
+        if (countCheckedIncludes(results->otherHeaders[i]) == 0)
+            return false;
+    }
+
+    // Find the included files without tokenizing them. Missing headers
+    // are reported by the stored results.
+    Options scanOptions(*pOptions);
+    scanOptions.IgnoreMissingIncludeFile = true;
+    std::ostringstream scanErrors;
+    Tokenizer tokenizer;
+    tokenizer.scanIncludes(FileName, includePaths, skipIncludes, &scanOptions, scanErrors);
+
+    // The headers that have changed since the previous run are summarized,
+    // so only changes of their interfaces change the key
+    if (pOptions->EnabledChecks.empty() && !pOptions->IncludeCost)
+        SummarizeHeaders(tokenizer, includePaths, skipIncludes, pOptions, &symbolCache);
+
+    const std::set<std::string> ownHeaders(results->ownHeaders.begin(), results->ownHeaders.end());
+    const FileHash key = symbolCache.resultsKey(tokenizer, ownHeaders, pOptions, skipIncludes);
+    if (key == 0 || key != results->key)
+        return false;
+
+    if (pOptions->Progress)
+        std::cout << "progress: reusing the results of the previous run" << std::endl;
+
+    checkedIncludes.insert(results->checkedIncludes.begin(), results->checkedIncludes.end());
+
+    // The includes in the headers are not checked again, the unneeded ones
+    // are taken from the include graph of the previous run so the files that
+    // include the headers later don't clear them
+    if (collectIncludeGraph)
+    {
+        const std::map<std::string, IncludeGraph::File> &files = includeGraph.getFiles();
+        for (unsigned int i = 0; i < tokenizer.FullFileNames.size(); ++i)
+        {
+            const std::map<std::string, IncludeGraph::File>::const_iterator file = files.find(tokenizer.FullFileNames[i]);
+            if (file == files.end())
+                continue;
+            for (unsigned int k = 0; k < file->second.includes.size(); ++k)
+            {
+                if (!file->second.includes[k].unneeded)
+                    continue;
+                std::ostringstream line;
+                line << file->first << ':' << file->second.includes[k].linenr;
+                unneededIncludes.insert(line.str());
+            }
+        }
+        includeGraph.add(tokenizer, &unneededIncludes);
+    }
+
+    for (unsigned int i = 0; i < results->messages.size(); ++i)
+        ReportMessage(results->messages[i], errout);
+    return true;
+}
+
+// Store the results of a checked source file
+static void SaveResults(const char FileName[], const Tokenizer &tokenizer,
+                        const std::vector<unsigned int> &checkedBefore,
+                        const std::vector<std::string> &messages,
+                        const Options *pOptions, const std::set<std::string> &skipIncludes)
+{
+    SourceResults results;
+    std::set<std::string> ownHeaders;
+    for (unsigned int i = 1; i < tokenizer.FullFileNames.size(); ++i)
+    {
+        const std::string &header = tokenizer.FullFileNames[i];
+        const unsigned int checked = countCheckedIncludes(header);
+        if (checked > checkedBefore[i])
+        {
+            if (ownHeaders.insert(header).second)
+            {
+                results.ownHeaders.push_back(header);
+                const std::string prefix(header + ":");
+                for (std::set<std::string>::const_iterator it = checkedIncludes.lower_bound(prefix);
+                     it != checkedIncludes.end() && it->compare(0, prefix.size(), prefix) == 0; ++it)
+                    results.checkedIncludes.push_back(*it);
+            }
+        }
+        else if (checked > 0)
+            results.otherHeaders.push_back(header);
+    }
+
+    results.key = symbolCache.resultsKey(tokenizer, ownHeaders, pOptions, skipIncludes);
+    results.messages = messages;
+    if (results.key != 0)
+        symbolCache.setResults(FileName, results);
+}
+//---------------------------------------------------------------------------
+
 //---------------------------------------------------------------------------
 // CppCheck - A function that checks a specified file
 //---------------------------------------------------------------------------
 
 static void CheckFile(const char FileName[], const Options *pOptions,
                       const std::vector<std::string> &includePaths,
-                      const std::set<std::string> &skipIncludes)
+                      const std::set<std::string> &skipIncludes,
+                      std::ostream &errout)
 {
     std::cout << "Checking " << FileName << "...\n";
 
+    // Only resolve the includes..
+    if (pOptions->ResolveOnly)
+    {
+        Tokenizer tokenizer;
+        tokenizer.scanIncludes(FileName, includePaths, skipIncludes, pOptions, errout);
+        if (collectIncludeGraph)
+            includeGraph.add(tokenizer);
+        return;
+    }
+
+    // Reuse the results of the previous run..
+    if (pOptions->Incremental && ReuseResults(FileName, pOptions, includePaths, skipIncludes, errout))
+        return;
+
+    // Record the reported errors so they can be reused in the next run
+    std::vector<std::string> messages;
+    if (pOptions->Incremental)
+        RecordErrors(&messages);
+
     // Tokenize the file
     Tokenizer tokenizer;
-    tokenizer.tokenize(FileName, includePaths, skipIncludes, pOptions, std::cerr);
+    tokenizer.tokenize(FileName, includePaths, skipIncludes, pOptions, errout);
 
     // debug output..
     if (pOptions->Debug)
@@ -220,11 +763,239 @@ static void CheckFile(const char FileName[], const Options *pOptions,
         std::cout << "\n";
     }
 
-    // Including header which is not needed
-    WarningIncludeHeader(tokenizer, pOptions, std::cerr);
+    // Includes in the headers that have been checked before..
+    std::vector<unsigned int> checkedBefore(tokenizer.FullFileNames.size(), 0);
+    if (pOptions->Incremental)
+    {
+        for (unsigned int i = 1; i < tokenizer.FullFileNames.size(); ++i)
+            checkedBefore[i] = countCheckedIncludes(tokenizer.FullFileNames[i]);
+    }
+
+    // Run the enabled checks
+    const CheckContext context(pOptions, &symbolCache, &checkedIncludes,
+                               collectFixIts ? &fixIts : NULL,
+                               collectIncludeGraph ? &unneededIncludes : NULL,
+                               collectHeaderUsage ? &headerUsage : NULL);
+    runChecks(tokenizer, context, errout);
+
+    // The graph is added after the checks so the unneeded includes are known
+    if (collectIncludeGraph)
+        includeGraph.add(tokenizer, &unneededIncludes);
+
+    if (pOptions->Incremental)
+    {
+        RecordErrors(NULL);
+        SaveResults(FileName, tokenizer, checkedBefore, messages, pOptions, skipIncludes);
+    }
 }
 //---------------------------------------------------------------------------
 
+//---------------------------------------------------------------------------
+// Errors sorted by the cost of the include
+//---------------------------------------------------------------------------
+
+// The tokens in the "(cost: .. tokens)" annotation of an error
+static unsigned long messageCost(const std::string &msg)
+{
+    const std::string::size_type pos = msg.rfind(" bytes, ");
+    if (pos == std::string::npos || msg.find("(cost: ") == std::string::npos)
+        return 0;
+    return std::strtoul(msg.c_str() + pos + 8, NULL, 10);
+}
+
+static bool moreExpensive(const std::string &msg1, const std::string &msg2)
+{
+    return messageCost(msg1) > messageCost(msg2);
+}
+
+static void PrintSortedByCost(const std::string &errors)
+{
+    std::vector<std::string> messages;
+    std::istringstream istr(errors);
+    std::string line;
+    while (std::getline(istr, line))
+        messages.push_back(line);
+
+    std::stable_sort(messages.begin(), messages.end(), moreExpensive);
+    for (unsigned int i = 0; i < messages.size(); ++i)
+        std::cerr << messages[i] << std::endl;
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// Header weights
+//---------------------------------------------------------------------------
+
+static void PrintHeaderWeights()
+{
+    const std::vector<IncludeGraph::HeaderWeight> weights(includeGraph.headerWeights());
+
+    std::cout << "Header weights:\n"
+              << std::setw(12) << "total" << std::setw(8) << "direct" << std::setw(8) << "tus"
+              << std::setw(10) << "tokens" << std::setw(8) << "files" << std::setw(10) << "closure"
+              << "  header\n";
+    for (unsigned int i = 0; i < weights.size(); ++i)
+    {
+        const IncludeGraph::HeaderWeight &weight = weights[i];
+        std::cout << std::setw(12) << weight.totalTokens
+                  << std::setw(8) << weight.directIncluders
+                  << std::setw(8) << weight.includers
+                  << std::setw(10) << weight.tokens
+                  << std::setw(8) << weight.closureFiles
+                  << std::setw(10) << weight.closureTokens
+                  << "  " << weight.path << "\n";
+    }
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// Precompiled headers
+//---------------------------------------------------------------------------
+
+// Headers that have changed in more than pchMaxChanges of the latest
+// pchCommits git commits are not precompiled, and neither are headers that
+// cost less than pchMinShare percent of the average source file
+static const unsigned int pchCommits = 500;
+static const unsigned int pchMaxChanges = 5;
+static const unsigned int pchMinShare = 5;
+
+static void PrintPrecompiledHeaders()
+{
+    // How often the files have changed..
+    std::vector<std::string> changed;
+    if (!FileLister::recentChanges(changed, pchCommits))
+        std::cout << "The git history is not available, all headers are considered stable.\n";
+
+    std::map<std::string, unsigned int> counts;
+    for (unsigned int i = 0; i < changed.size(); ++i)
+        ++counts[comparablePath(changed[i])];
+
+    std::map<std::string, unsigned int> changes;
+    const std::map<std::string, IncludeGraph::File> &files = includeGraph.getFiles();
+    for (std::map<std::string, IncludeGraph::File>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        const std::map<std::string, unsigned int>::const_iterator count = counts.find(comparablePath(it->first));
+        if (count != counts.end())
+            changes[it->first] = count->second;
+    }
+
+    const std::vector<IncludeGraph::PrecompiledHeader> pchs(includeGraph.precompiledHeaders(changes, pchMaxChanges, pchMinShare));
+    for (unsigned int i = 0; i < pchs.size(); ++i)
+    {
+        const IncludeGraph::PrecompiledHeader &pch = pchs[i];
+        std::cout << "Precompiled header for " << pch.directory << " (" << pch.sources << " source files):\n";
+        for (unsigned int k = 0; k < pch.headers.size(); ++k)
+        {
+            std::cout << "    " << pch.headers[k] << " (included by " << pch.includers[k]
+                      << " files, " << pch.tokens[k] << " tokens)\n";
+        }
+        std::cout << "    estimated tokens saved per source file: " << pch.savedTokens << "\n";
+    }
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// Header splits
+//---------------------------------------------------------------------------
+
+static void PrintHeaderSplits()
+{
+    const std::vector<HeaderUsage::Split> splits(headerUsage.suggestSplits());
+    for (unsigned int i = 0; i < splits.size(); ++i)
+    {
+        const HeaderUsage::Split &split = splits[i];
+        std::cout << "Split " << split.path << " (" << split.tokens << " tokens, used by "
+                  << split.includers << " files):\n";
+        for (unsigned int k = 0; k < split.parts.size(); ++k)
+        {
+            std::cout << "    part " << (k + 1) << " (used by " << split.partIncluders[k]
+                      << " files, about " << split.partTokens[k] << " tokens):";
+            for (unsigned int n = 0; n < split.parts[k].size(); ++n)
+                std::cout << " " << split.parts[k][n];
+            std::cout << "\n";
+        }
+        std::cout << "    estimated tokens saved: " << split.savedTokens << "\n";
+    }
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// Dead headers
+//---------------------------------------------------------------------------
+
+static void PrintDeadHeaders(const std::vector<std::string> &paths)
+{
+    // The headers under the checked paths, with the paths of the include graph..
+    std::map<std::string, std::string> graphPaths;
+    const std::map<std::string, IncludeGraph::File> &files = includeGraph.getFiles();
+    for (std::map<std::string, IncludeGraph::File>::const_iterator it = files.begin(); it != files.end(); ++it)
+        graphPaths[comparablePath(it->first)] = it->first;
+
+    std::vector<std::string> headers;
+    for (unsigned int i = 0; i < paths.size(); ++i)
+    {
+        std::vector<std::string> found;
+        FileLister::recursiveAddFiles(found, paths[i], true, FileLister::acceptHeader);
+        for (unsigned int k = 0; k < found.size(); ++k)
+        {
+            const std::map<std::string, std::string>::const_iterator graphPath = graphPaths.find(comparablePath(found[k]));
+            if (graphPath != graphPaths.end())
+            {
+                headers.push_back(graphPath->second);
+                continue;
+            }
+
+            std::string path(FileLister::simplifyPath(found[k].c_str()));
+            while (path.compare(0, 2, "./") == 0 || path.compare(0, 2, ".\\") == 0)
+                path.erase(0, 2);
+            headers.push_back(path);
+        }
+    }
+
+    const std::vector<IncludeGraph::DeadHeader> dead(includeGraph.deadHeaders(headers));
+
+    std::cout << "Dead headers: " << dead.size() << "\n"
+              << std::setw(12) << "saved" << std::setw(8) << "sites" << std::setw(8) << "tus"
+              << std::setw(10) << "tokens" << "  header\n";
+    for (unsigned int i = 0; i < dead.size(); ++i)
+    {
+        const IncludeGraph::DeadHeader &header = dead[i];
+        std::cout << std::setw(12) << header.savedTokens
+                  << std::setw(8) << header.includeSites
+                  << std::setw(8) << header.includers
+                  << std::setw(10) << header.tokens
+                  << "  " << header.path
+                  << (header.includeSites == 0 ? " (not included)" : "") << "\n";
+    }
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// Include graph export
+//---------------------------------------------------------------------------
+
+static bool ExportGraph(const std::string &format, const std::string &filename)
+{
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    if (format == "dot")
+        includeGraph.writeDot(fout);
+    else
+        includeGraph.writeJson(fout);
+    if (!fout.good())
+        return false;
+
+    const std::vector< std::vector<std::string> > cycles(includeGraph.cycles());
+    std::cout << "Include cycles: " << cycles.size() << "\n";
+    for (unsigned int c = 0; c < cycles.size(); ++c)
+    {
+        std::cout << "   ";
+        for (unsigned int i = 0; i < cycles[c].size(); ++i)
+            std::cout << " " << cycles[c][i];
+        std::cout << "\n";
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
 
 
 
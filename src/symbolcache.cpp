@@ -0,0 +1,520 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//---------------------------------------------------------------------------
+#include "symbolcache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+//---------------------------------------------------------------------------
+
+// Database layout. Numbers are stored in native byte order, the database
+// is a local cache that is not shared between machines.
+//
+//   magic      "chsymdb2"
+//   count      number of headers
+//   buckets    size of the hash index, a power of 2
+//   results    offset of the source file results
+//   sources    number of source file results
+//   index      buckets * { hash, offset, size }. size 0 => empty bucket
+//   records    classes, names, declarations and includes. Each list is
+//              a count followed by zero terminated strings.
+//   results    for each source file: file name, key, own headers, other
+//              headers, checked includes and messages.
+
+static const char dbMagic[] = "chsymdb2";
+
+static const unsigned int headerSize = 24;
+
+struct IndexEntry
+{
+    FileHash hash;
+    unsigned int offset;
+    unsigned int size;
+};
+
+//---------------------------------------------------------------------------
+
+static void writeInt(std::string &out, unsigned int value)
+{
+    out.append((const char *)&value, sizeof(value));
+}
+
+static void writeHash(std::string &out, FileHash value)
+{
+    out.append((const char *)&value, sizeof(value));
+}
+
+static void writeString(std::string &out, const std::string &str)
+{
+    out.append(str.c_str(), str.size() + 1);
+}
+
+static void writeStrings(std::string &out, const std::vector<std::string> &strings)
+{
+    writeInt(out, strings.size());
+    for (unsigned int k = 0; k < strings.size(); ++k)
+        writeString(out, strings[k]);
+}
+//---------------------------------------------------------------------------
+
+// Read a record. All reads are checked against the end of the record.
+class RecordReader
+{
+public:
+    RecordReader(const char *data, unsigned int size) : pos(data), end(data + size)
+    { }
+
+    bool readInt(unsigned int &value)
+    {
+        if (end - pos < (long)sizeof(value))
+            return false;
+        std::memcpy(&value, pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    }
+
+    bool readHash(FileHash &value)
+    {
+        if (end - pos < (long)sizeof(value))
+            return false;
+        std::memcpy(&value, pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    }
+
+    bool readString(std::string &str)
+    {
+        const char *s = (const char *)std::memchr(pos, 0, end - pos);
+        if (!s)
+            return false;
+        str.assign(pos, s);
+        pos = s + 1;
+        return true;
+    }
+
+    bool readStrings(std::vector<std::string> &strings)
+    {
+        unsigned int count;
+        if (!readInt(count))
+            return false;
+        strings.resize(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            if (!readString(strings[i]))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    const char *pos;
+    const char *end;
+};
+//---------------------------------------------------------------------------
+
+static unsigned int getHeaderInt(const char *db, unsigned int offset)
+{
+    unsigned int value;
+    std::memcpy(&value, db + offset, sizeof(value));
+    return value;
+}
+
+static unsigned int getBuckets(const char *db)
+{
+    return getHeaderInt(db, 12);
+}
+//---------------------------------------------------------------------------
+
+void sortSymbols(SymbolIds &ids)
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+void removeSymbols(SymbolIds &ids, const SymbolIds &remove)
+{
+    SymbolIds result;
+    result.reserve(ids.size());
+    std::set_difference(ids.begin(), ids.end(), remove.begin(), remove.end(), std::back_inserter(result));
+    ids.swap(result);
+}
+
+bool hasSymbol(const SymbolIds &ids, SymbolId id)
+{
+    return std::binary_search(ids.begin(), ids.end(), id);
+}
+//---------------------------------------------------------------------------
+
+SymbolCache::SymbolCache() : db(NULL), dbSize(0), dbMapped(false)
+{
+}
+
+SymbolCache::~SymbolCache()
+{
+    close();
+}
+
+void SymbolCache::close()
+{
+#if defined(__GNUC__) && !defined(__MINGW32__)
+    if (dbMapped)
+        munmap((void *)db, dbSize);
+    else
+#endif
+        delete [] db;
+    db = NULL;
+    dbSize = 0;
+    dbMapped = false;
+}
+//---------------------------------------------------------------------------
+
+const HeaderSymbols *SymbolCache::find(FileHash hash)
+{
+    std::map<FileHash, HeaderSymbols>::const_iterator it = summaries.find(hash);
+    if (it != summaries.end())
+        return &it->second;
+
+    // Read the symbols from the database..
+    HeaderSymbols symbols;
+    if (!findInDatabase(hash, symbols))
+        return NULL;
+    HeaderSymbols &ret = summaries[hash];
+    ret = symbols;
+    return &ret;
+}
+//---------------------------------------------------------------------------
+
+HeaderSymbols &SymbolCache::add(FileHash hash)
+{
+    return summaries[hash];
+}
+//---------------------------------------------------------------------------
+
+FileHash SymbolCache::getFingerprint(FileHash hash)
+{
+    std::map<FileHash, FileHash>::const_iterator it = fingerprints.find(hash);
+    if (it != fingerprints.end())
+        return it->second;
+
+    const HeaderSymbols *symbols = find(hash);
+    if (!symbols)
+        return 0;
+
+    // The symbol ids depend on the order the names are seen, so the
+    // names are sorted..
+    std::string data;
+    const SymbolIds * const lists[] = { &symbols->classes, &symbols->names, &symbols->declarations };
+    for (unsigned int list = 0; list < 3; ++list)
+    {
+        std::vector<std::string> names;
+        for (unsigned int k = 0; k < lists[list]->size(); ++k)
+            names.push_back(getName((*lists[list])[k]));
+        std::sort(names.begin(), names.end());
+        writeStrings(data, names);
+    }
+    writeStrings(data, symbols->includes);
+
+    const FileHash fingerprint = hashContents(data);
+    fingerprints[hash] = fingerprint;
+    return fingerprint;
+}
+//---------------------------------------------------------------------------
+
+FileHash SymbolCache::resultsKey(const Tokenizer &tokenizer, const std::set<std::string> &ownHeaders,
+                                const Options *pOptions, const std::set<std::string> &skipIncludes)
+{
+    std::ostringstream key;
+    key << pOptions->outputFormat << ' ' << pOptions->IgnoreMissingIncludeFile << ' ' << pOptions->IncludeCost;
+    for (std::set<std::string>::const_iterator it = skipIncludes.begin(); it != skipIncludes.end(); ++it)
+        key << " skip:" << *it;
+    for (std::set<std::string>::const_iterator it = pOptions->EnabledChecks.begin(); it != pOptions->EnabledChecks.end(); ++it)
+        key << " enable:" << *it;
+
+    for (unsigned int i = 0; i < tokenizer.FullFileNames.size(); ++i)
+    {
+        key << '\n' << tokenizer.FullFileNames[i] << ' ' << tokenizer.ShortFileNames[i] << ' ';
+
+        // The other checks and the include costs look at the contents of the headers
+        if (i == 0 || ownHeaders.count(tokenizer.FullFileNames[i]) || !pOptions->EnabledChecks.empty() || pOptions->IncludeCost)
+            key << tokenizer.FileHashes[i];
+        else
+        {
+            const FileHash fingerprint = getFingerprint(tokenizer.FileHashes[i]);
+            if (fingerprint == 0)
+                return 0;
+            key << "interface:" << fingerprint;
+        }
+    }
+
+    for (unsigned int i = 0; i < tokenizer.FileAliases.size(); ++i)
+        key << '\n' << tokenizer.FileAliases[i].first << '=' << tokenizer.FileAliases[i].second;
+
+    return hashContents(key.str());
+}
+//---------------------------------------------------------------------------
+
+const SourceResults *SymbolCache::findResults(const std::string &filename)
+{
+    std::map<std::string, SourceResults>::const_iterator it = results.find(filename);
+    if (it == results.end())
+        return NULL;
+    usedResults.insert(filename);
+    return &it->second;
+}
+
+void SymbolCache::setResults(const std::string &filename, const SourceResults &sourceResults)
+{
+    results[filename] = sourceResults;
+    usedResults.insert(filename);
+}
+//---------------------------------------------------------------------------
+
+SymbolId SymbolCache::getId(const std::string &name)
+{
+    std::map<std::string, SymbolId>::const_iterator it = symbolIds.find(name);
+    if (it != symbolIds.end())
+        return it->second;
+    const SymbolId id = symbolNames.size();
+    symbolIds[name] = id;
+    symbolNames.push_back(name);
+    return id;
+}
+
+const std::string &SymbolCache::getName(SymbolId id) const
+{
+    return symbolNames[id];
+}
+//---------------------------------------------------------------------------
+
+std::string SymbolCache::writeRecord(const HeaderSymbols &symbols) const
+{
+    std::string out;
+    const SymbolIds * const lists[] = { &symbols.classes, &symbols.names, &symbols.declarations };
+    for (unsigned int list = 0; list < 3; ++list)
+    {
+        writeInt(out, lists[list]->size());
+        for (unsigned int k = 0; k < lists[list]->size(); ++k)
+            writeString(out, getName((*lists[list])[k]));
+    }
+    writeStrings(out, symbols.includes);
+    return out;
+}
+//---------------------------------------------------------------------------
+
+bool SymbolCache::findInDatabase(FileHash hash, HeaderSymbols &symbols)
+{
+    if (!db)
+        return false;
+
+    const unsigned int buckets = getBuckets(db);
+    const IndexEntry *index = (const IndexEntry *)(db + headerSize);
+
+    for (unsigned int i = 0; i < buckets; ++i)
+    {
+        const IndexEntry &entry = index[(hash + i) & (buckets - 1)];
+        if (entry.size == 0)
+            return false;
+        if (entry.hash != hash)
+            continue;
+        if ((unsigned long)entry.offset + entry.size > dbSize)
+            return false;
+
+        RecordReader reader(db + entry.offset, entry.size);
+        SymbolIds * const lists[] = { &symbols.classes, &symbols.names, &symbols.declarations };
+        for (unsigned int list = 0; list < 3; ++list)
+        {
+            std::vector<std::string> strings;
+            if (!reader.readStrings(strings))
+                return false;
+            for (unsigned int k = 0; k < strings.size(); ++k)
+                lists[list]->push_back(getId(strings[k]));
+            sortSymbols(*lists[list]);
+        }
+        return reader.readStrings(symbols.includes);
+    }
+    return false;
+}
+//---------------------------------------------------------------------------
+
+bool SymbolCache::load(const std::string &filename)
+{
+    close();
+
+#if defined(__GNUC__) && !defined(__MINGW32__)
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            db = (const char *)data;
+            dbSize = st.st_size;
+            dbMapped = true;
+        }
+    }
+    ::close(fd);
+#else
+    std::ifstream fin(filename.c_str(), std::ios::binary);
+    if (fin.is_open())
+    {
+        std::ostringstream ostr;
+        ostr << fin.rdbuf();
+        const std::string data(ostr.str());
+        char *buf = new char[data.size()];
+        std::memcpy(buf, data.data(), data.size());
+        db = buf;
+        dbSize = data.size();
+    }
+#endif
+
+    // Validate the header and the size of the index..
+    bool valid = bool(db != NULL && dbSize >= headerSize && std::memcmp(db, dbMagic, 8) == 0);
+    if (valid)
+    {
+        const unsigned int buckets = getBuckets(db);
+        valid = bool(buckets > 0 && (buckets & (buckets - 1)) == 0 &&
+                     (dbSize - headerSize) / sizeof(IndexEntry) >= buckets);
+    }
+
+    if (!valid)
+        close();
+    else if (!loadResults())
+        results.clear();
+    return valid;
+}
+
+bool SymbolCache::loadResults()
+{
+    results.clear();
+    const unsigned int offset = getHeaderInt(db, 16);
+    const unsigned int count = getHeaderInt(db, 20);
+    if (offset > dbSize)
+        return false;
+
+    RecordReader reader(db + offset, dbSize - offset);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        std::string filename;
+        SourceResults sourceResults;
+        if (!reader.readString(filename) ||
+            !reader.readHash(sourceResults.key) ||
+            !reader.readStrings(sourceResults.ownHeaders) ||
+            !reader.readStrings(sourceResults.otherHeaders) ||
+            !reader.readStrings(sourceResults.checkedIncludes) ||
+            !reader.readStrings(sourceResults.messages))
+            return false;
+        results[filename] = sourceResults;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+
+bool SymbolCache::save(const std::string &filename, bool compact)
+{
+    // Records that are written..
+    std::map<FileHash, std::string> records;
+    for (std::map<FileHash, HeaderSymbols>::const_iterator it = summaries.begin(); it != summaries.end(); ++it)
+        records[it->first] = writeRecord(it->second);
+
+    // Copy the other records from the loaded database..
+    if (db && !compact)
+    {
+        const unsigned int buckets = getBuckets(db);
+        const IndexEntry *index = (const IndexEntry *)(db + headerSize);
+        for (unsigned int i = 0; i < buckets; ++i)
+        {
+            if (index[i].size > 0 &&
+                (unsigned long)index[i].offset + index[i].size <= dbSize &&
+                records.find(index[i].hash) == records.end())
+            {
+                records[index[i].hash] = std::string(db + index[i].offset, index[i].size);
+            }
+        }
+    }
+
+    // Create the hash index..
+    unsigned int buckets = 1;
+    while (buckets < 2 * records.size())
+        buckets *= 2;
+
+    std::vector<IndexEntry> index(buckets);
+    std::memset(&index[0], 0, buckets * sizeof(IndexEntry));
+    std::string data;
+    unsigned int offset = headerSize + buckets * sizeof(IndexEntry);
+    for (std::map<FileHash, std::string>::const_iterator it = records.begin(); it != records.end(); ++it)
+    {
+        unsigned int bucket = it->first & (buckets - 1);
+        while (index[bucket].size > 0)
+            bucket = (bucket + 1) & (buckets - 1);
+        index[bucket].hash = it->first;
+        index[bucket].offset = offset;
+        index[bucket].size = it->second.size();
+        offset += it->second.size();
+        data += it->second;
+    }
+
+    // Results of the source files..
+    std::string resultsData;
+    unsigned int resultsCount = 0;
+    for (std::map<std::string, SourceResults>::const_iterator it = results.begin(); it != results.end(); ++it)
+    {
+        if (compact && usedResults.find(it->first) == usedResults.end())
+            continue;
+        writeString(resultsData, it->first);
+        writeHash(resultsData, it->second.key);
+        writeStrings(resultsData, it->second.ownHeaders);
+        writeStrings(resultsData, it->second.otherHeaders);
+        writeStrings(resultsData, it->second.checkedIncludes);
+        writeStrings(resultsData, it->second.messages);
+        ++resultsCount;
+    }
+
+    std::string header(dbMagic, 8);
+    writeInt(header, records.size());
+    writeInt(header, buckets);
+    writeInt(header, offset);
+    writeInt(header, resultsCount);
+
+    // The loaded database might be the file that is written
+    close();
+
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    if (!fout.is_open())
+        return false;
+    fout.write(header.data(), header.size());
+    fout.write((const char *)&index[0], buckets * sizeof(IndexEntry));
+    fout.write(data.data(), data.size());
+    fout.write(resultsData.data(), resultsData.size());
+    return fout.good();
+}
+//---------------------------------------------------------------------------
+
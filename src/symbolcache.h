@@ -0,0 +1,186 @@
+/*
+ * checkheaders - check headers in C/C++ code
+ * Copyright (C) 2010 Daniel Marjamki.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+//---------------------------------------------------------------------------
+#ifndef symbolcacheH
+#define symbolcacheH
+//---------------------------------------------------------------------------
+
+#include "tokenize.h"   // <- FileHash
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Symbol names are interned, each name gets an id
+typedef unsigned int SymbolId;
+
+// Sorted list of symbol ids without duplicates
+typedef std::vector<SymbolId> SymbolIds;
+
+// Sort the ids and remove duplicates
+void sortSymbols(SymbolIds &ids);
+
+// Remove the ids in "remove" from "ids". Both lists must be sorted.
+void removeSymbols(SymbolIds &ids, const SymbolIds &remove);
+
+// Is the symbol in the sorted list?
+bool hasSymbol(const SymbolIds &ids, SymbolId id);
+
+// Symbols that a header makes available to the files that include it
+struct HeaderSymbols
+{
+    SymbolIds classes;                   // class and struct names
+    SymbolIds names;                     // variables, enums, functions, typedefs, #defines
+    SymbolIds declarations;              // forward declarations "struct X;"
+    std::vector<std::string> includes;   // headers included directly, "<x.h>" for system includes
+};
+
+// Results of a checked source file. They are reused in the next run if
+// nothing that they depend on has changed.
+struct SourceResults
+{
+    SourceResults() : key(0)
+    { }
+
+    FileHash key;                               // hash of what the results depend on
+    std::vector<std::string> ownHeaders;        // headers whose includes were checked with the source file
+    std::vector<std::string> otherHeaders;      // headers whose includes were checked with earlier source files
+    std::vector<std::string> checkedIncludes;   // the checked includes in ownHeaders
+    std::vector<std::string> messages;          // reported errors
+};
+
+/**
+ * Symbols of headers that have been checked. The headers are identified
+ * by the hash of their contents so the symbols of a header are only
+ * extracted once even though it is included by many source files.
+ *
+ * The symbols can be stored in a database file and loaded in a later
+ * run. A header that has changed gets a new hash, so it is not found in
+ * the database and its symbols are extracted again. The results of the
+ * checked source files are stored in the database too.
+ */
+class SymbolCache
+{
+public:
+    SymbolCache();
+    ~SymbolCache();
+
+    /**
+     * get the symbols of a header
+     * @param hash hash of the header contents
+     * @return the symbols or NULL if the header has not been summarized
+     */
+    const HeaderSymbols *find(FileHash hash);
+
+    /** add a header. The returned symbols should be filled in by the caller */
+    HeaderSymbols &add(FileHash hash);
+
+    /** get id for a symbol name. A new name gets a new id. */
+    SymbolId getId(const std::string &name);
+
+    /** get the name of a symbol id */
+    const std::string &getName(SymbolId id) const;
+
+    /**
+     * get a fingerprint of the symbols of a header. It only changes when
+     * the symbols or includes that other files see are changed.
+     * @param hash hash of the header contents
+     * @return the fingerprint or 0 if the header has not been summarized
+     */
+    FileHash getFingerprint(FileHash hash);
+
+    /**
+     * get a hash of what the results of a source file depend on: the
+     * options, the source file, the contents of the headers whose includes
+     * were checked with it and the fingerprints of the other headers
+     * @param tokenizer the source file with its includes resolved
+     * @param ownHeaders headers whose includes were checked with the source file
+     * @return the hash or 0 if a header has not been summarized
+     */
+    FileHash resultsKey(const Tokenizer &tokenizer, const std::set<std::string> &ownHeaders,
+                        const Options *pOptions, const std::set<std::string> &skipIncludes);
+
+    /**
+     * get the results of a source file from a previous run
+     * @param filename source file
+     * @return the results or NULL if there are none
+     */
+    const SourceResults *findResults(const std::string &filename);
+
+    /** set the results of a source file */
+    void setResults(const std::string &filename, const SourceResults &results);
+
+    /**
+     * load a database file. The headers are read when they are needed.
+     * @param filename database file
+     * @return false if the file is missing or invalid
+     */
+    bool load(const std::string &filename);
+
+    /**
+     * write a database file. The headers of the loaded database are
+     * written together with the headers that are summarized in this run.
+     * @param filename database file
+     * @param compact only write the headers and results that were used in this run
+     * @return false if the file could not be written
+     */
+    bool save(const std::string &filename, bool compact);
+
+private:
+    // No copying
+    SymbolCache(const SymbolCache &);
+    SymbolCache &operator=(const SymbolCache &);
+
+    // Release the loaded database
+    void close();
+
+    // Read the results of the source files from the loaded database
+    bool loadResults();
+
+    // Read a header from the loaded database
+    bool findInDatabase(FileHash hash, HeaderSymbols &symbols);
+
+    // Write a header to the database
+    std::string writeRecord(const HeaderSymbols &symbols) const;
+
+    std::map<FileHash, HeaderSymbols> summaries;
+
+    // Interned symbol names
+    std::map<std::string, SymbolId> symbolIds;
+    std::vector<std::string> symbolNames;
+
+    // Fingerprints of the summarized headers
+    std::map<FileHash, FileHash> fingerprints;
+
+    // Results of the source files. The results that are used in this run
+    // are written by a compact save.
+    std::map<std::string, SourceResults> results;
+    std::set<std::string> usedResults;
+
+    // Loaded database
+    const char *db;
+    unsigned long dbSize;
+    bool dbMapped;
+};
+
+//---------------------------------------------------------------------------
+#endif
+
@@ -21,10 +21,12 @@
 #include "commoncheck.h"    // <- IsName
 //---------------------------------------------------------------------------
 
+#include <algorithm>  // count
 #include <iterator>   // back_inserter
 
 #include <locale>
 #include <fstream>
+#include <sstream>
 
 #include <string>
 #include <cstring>
@@ -40,6 +42,8 @@
 
 static void combine_2tokens(Token *tok, const char str1[], const char str2[]);
 
+static bool parseInclude(std::string line, std::string &header, bool &SystemHeader);
+
 //---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
@@ -72,6 +76,7 @@ void Tokenizer::addtoken(const char str[], const unsigned int lineno, const unsi
     newtoken->str    = strdup(str2.str().c_str());
     newtoken->linenr = lineno;
     newtoken->FileIndex = fileno;
+    ++FileTokens[fileno];
     if (tokens_back)
     {
         tokens_back->next = newtoken;
@@ -136,69 +141,288 @@ Tokenizer::~Tokenizer()
     }
 }
 
-bool Tokenizer::tokenize(const char FileName[],
-                         const std::vector<std::string> &includePaths,
-                         const std::set<std::string> &skipIncludes,
-                         const Options *pOption, std::ostream &errout)
+Tokenizer::FileStatus Tokenizer::addFile(const char FileName[],
+                                         const std::vector<std::string> &includePaths,
+                                         std::string &data)
 {
     // Skip stdafx.h..
     if (SameFileName(FileName, "stdafx.h"))
-        return true;
+        return FILE_KNOWN;
 
     // Has this file been tokenized already?
-    for (unsigned int i = 0; i < ShortFileNames.size(); i++)
-    {
-        if (SameFileName(ShortFileNames[i].c_str(), FileName))
-            return true;
-    }
-
-    std::string filename(FileName);
+    if (getFileIndex(FileName) < ShortFileNames.size())
+        return FILE_KNOWN;
 
     // Open file..
-    std::ifstream fin(FileName);
+    const std::string filename(findFile(FileName, includePaths));
+    if (filename.empty())
+        return FILE_NOT_FOUND;
+    std::ifstream fin(filename.c_str());
     if (!fin.is_open())
+        return FILE_NOT_FOUND;
+
+    // Read the file..
+    std::ostringstream ostr;
+    ostr << fin.rdbuf();
+    data = ostr.str();
+    const FileHash hash = hashContents(data);
+
+    // Has a file with the same contents been tokenized already? The main
+    // source file is not shared, its symbols are not extracted.
+    for (unsigned int i = 1; i < FileHashes.size(); i++)
     {
-        for (unsigned int i = 0; i < includePaths.size(); ++i)
+        if (FileHashes[i] == hash && FileSizes[i] == data.size())
         {
-            filename = includePaths[i];
-
-            // Append '/' if the last char is neither '/' nor '\'
-            char lastChar = '/';
-            if (!filename.empty())
-                lastChar = filename[filename.size() - 1];
-            if (lastChar != '\\' && lastChar != '/')
-                filename += '/';
-
-            // Append FileName
-            filename += FileName;
-
-            // Try to open file
-            fin.clear();
-            fin.open(filename.c_str());
-            if (fin.is_open())
-                break;
+            FileAliases.push_back(std::make_pair(std::string(FileName), i));
+            AliasFullFileNames.push_back(filename);
+            return FILE_KNOWN;
         }
-
-        if (!fin.is_open())
-            return false;
     }
 
+    if (FullFileNames.empty())
+        IncludePaths = includePaths;
+
     // The "Files" vector remembers what files have been tokenized..
     ShortFileNames.push_back(FileName);
     FullFileNames.push_back(filename);
+    FileHashes.push_back(hash);
+    FileSizes.push_back(data.size());
+    FileTokens.push_back(0);
+
+    return FILE_NEW;
+}
+//---------------------------------------------------------------------------
+
+std::string Tokenizer::findFile(const char FileName[],
+                                const std::vector<std::string> &includePaths)
+{
+    if (std::ifstream(FileName).is_open())
+        return FileName;
+
+    for (unsigned int i = 0; i < includePaths.size(); ++i)
+    {
+        std::string filename = includePaths[i];
+
+        // Append '/' if the last char is neither '/' nor '\'
+        char lastChar = '/';
+        if (!filename.empty())
+            lastChar = filename[filename.size() - 1];
+        if (lastChar != '\\' && lastChar != '/')
+            filename += '/';
+
+        // Append FileName
+        filename += FileName;
+
+        // Try to open file
+        if (std::ifstream(filename.c_str()).is_open())
+            return filename;
+    }
+
+    return "";
+}
+//---------------------------------------------------------------------------
+
+bool Tokenizer::tokenize(const char FileName[],
+                         const std::vector<std::string> &includePaths,
+                         const std::set<std::string> &skipIncludes,
+                         const Options *pOption, std::ostream &errout)
+{
+    std::string data;
+    const FileStatus status = addFile(FileName, includePaths, data);
+    if (status != FILE_NEW)
+        return bool(status == FILE_KNOWN);
 
     // Tokenize the file..
-    tokenizeCode(fin, FullFileNames.size() - 1, includePaths, skipIncludes,
+    std::istringstream code(data);
+    tokenizeCode(code, FullFileNames.size() - 1, includePaths, skipIncludes,
                  pOption, errout);
 
     return true;
 }
 //---------------------------------------------------------------------------
 
+bool Tokenizer::scanIncludes(const char FileName[],
+                             const std::vector<std::string> &includePaths,
+                             const std::set<std::string> &skipIncludes,
+                             const Options *pOption, std::ostream &errout)
+{
+    std::string data;
+    const FileStatus status = addFile(FileName, includePaths, data);
+    if (status != FILE_NEW)
+        return bool(status == FILE_KNOWN);
+
+    const unsigned int FileIndex = FullFileNames.size() - 1;
+
+    // Only look at the #include directives. Comments, strings and
+    // characters are skipped so they are handled as in tokenizeCode.
+    unsigned int lineno = 1;
+    bool newtoken = true;
+    for (std::string::size_type pos = 0; pos < data.size(); ++pos)
+    {
+        const char ch = data[pos];
+
+        if (ch == '\n')
+        {
+            ++lineno;
+            newtoken = true;
+        }
+
+        else if (ch == '/' && data.compare(pos, 2, "//") == 0)
+        {
+            pos = data.find('\n', pos);
+            if (pos == std::string::npos)
+                break;
+            --pos;
+        }
+
+        else if (ch == '/' && data.compare(pos, 2, "/*") == 0)
+        {
+            const std::string::size_type end = data.find("*/", pos + 2);
+            if (end == std::string::npos)
+                break;
+            lineno += std::count(data.begin() + pos, data.begin() + end, '\n');
+            pos = end + 1;
+            newtoken = true;
+        }
+
+        else if (ch == '\"' || ch == '\'')
+        {
+            for (++pos; pos < data.size() && data[pos] != ch; ++pos)
+            {
+                if (data[pos] == '\\')
+                    ++pos;
+            }
+            newtoken = true;
+        }
+
+        else if (ch == '#' && newtoken && data.compare(pos, 8, "#include") == 0)
+        {
+            std::string::size_type end = data.find('\n', pos);
+            if (end == std::string::npos)
+                end = data.size();
+
+            std::string header;
+            bool SystemHeader;
+            if (parseInclude(data.substr(pos + 8, end - pos - 8), header, SystemHeader) &&
+                skipIncludes.find(header) == skipIncludes.end())
+            {
+                const bool found(scanIncludes(header.c_str(), getIncludePaths(FileIndex, includePaths),
+                                              skipIncludes, pOption, errout));
+                addInclude(FileIndex, lineno, header, SystemHeader, found);
+                if (!found && !pOption->IgnoreMissingIncludeFile)
+                    headerNotFound(header, FileIndex, lineno, pOption, errout);
+            }
+
+            pos = end - 1;
+        }
+
+        else
+            newtoken = bool(std::isspace(ch) || strchr("+-*/%&|^?!=<>[](){};:,.", ch));
+    }
+
+    return true;
+}
+//---------------------------------------------------------------------------
+
+unsigned int Tokenizer::getFileIndex(const char ShortFileName[]) const
+{
+    for (unsigned int i = 0; i < ShortFileNames.size(); i++)
+    {
+        if (SameFileName(ShortFileNames[i].c_str(), ShortFileName))
+            return i;
+    }
+
+    for (unsigned int i = 0; i < FileAliases.size(); i++)
+    {
+        if (SameFileName(FileAliases[i].first.c_str(), ShortFileName))
+            return FileAliases[i].second;
+    }
+
+    return ShortFileNames.size();
+}
+//---------------------------------------------------------------------------
 
 
 
 
+
+//---------------------------------------------------------------------------
+// parseInclude
+// Extract the header name from the rest of a #include line
+//---------------------------------------------------------------------------
+
+static bool parseInclude(std::string line, std::string &header, bool &SystemHeader)
+{
+    if (line.find("//") != std::string::npos)
+        line.erase(line.find("//"));
+
+    if (line.find_first_of("<\"") == std::string::npos)
+        return false;
+
+    SystemHeader = bool(line.find("<") != std::string::npos);
+
+    // Extract the filename
+    line.erase(0, line.find_first_of("<\"")+1);
+    line.erase(line.find_first_of(">\""));
+    header = line;
+    return true;
+}
+//---------------------------------------------------------------------------
+
+std::vector<std::string> Tokenizer::getIncludePaths(const unsigned int FileIndex,
+                                                    const std::vector<std::string> &includePaths) const
+{
+    // Add path for current file to the include paths..
+    std::vector<std::string> incpaths;
+    if (FullFileNames[FileIndex].find_first_of("\\/") != std::string::npos)
+    {
+        std::string path = FullFileNames[FileIndex];
+        path.erase(1 + path.find_last_of("\\/"));
+        incpaths.push_back(path);
+    }
+    std::copy(includePaths.begin(), includePaths.end(), std::back_inserter(incpaths));
+    return incpaths;
+}
+//---------------------------------------------------------------------------
+
+void Tokenizer::addInclude(const unsigned int FileIndex, const unsigned int lineno,
+                           const std::string &header, bool SystemHeader, bool found)
+{
+    IncludeDirective include;
+    include.FileIndex = FileIndex;
+    include.linenr = lineno;
+    include.header = header;
+    include.SystemHeader = SystemHeader;
+    include.target = found ? getFileIndex(header.c_str()) : ShortFileNames.size();
+    if (include.target < ShortFileNames.size())
+    {
+        include.path = FullFileNames[include.target];
+
+        // The path of an identical file..
+        for (unsigned int i = 0; i < FileAliases.size(); i++)
+        {
+            if (SameFileName(FileAliases[i].first.c_str(), header.c_str()) &&
+                !SameFileName(ShortFileNames[include.target].c_str(), header.c_str()))
+            {
+                include.path = AliasFullFileNames[i];
+                break;
+            }
+        }
+    }
+    Includes.push_back(include);
+}
+//---------------------------------------------------------------------------
+
+void Tokenizer::headerNotFound(const std::string &header, const unsigned int FileIndex,
+                               const unsigned int lineno, const Options *pOptions,
+                               std::ostream &errout) const
+{
+    const std::string errmsg("Header not found '" + header + "'. Use -I or --skip to fix this message.");
+    ReportErr(pOptions->outputFormat, FullFileNames[FileIndex],
+              lineno, "HeaderNotFound", errmsg, errout);
+}
+//---------------------------------------------------------------------------
+
 //---------------------------------------------------------------------------
 // Tokenize - tokenizes input stream
 //---------------------------------------------------------------------------
@@ -232,42 +456,23 @@ void Tokenizer::tokenizeCode(std::istream &code, const unsigned int FileIndex,
             if (line.compare(0, 8, "#include")==0)
             {
                 getline(code, line);
-                if (line.find("//") != std::string::npos)
-                    line.erase(line.find("//"));
 
-                if (line.find_first_of("<\"") != std::string::npos)
+                std::string header;
+                bool SystemHeader;
+                if (parseInclude(line, header, SystemHeader) &&
+                    skipIncludes.find(header) == skipIncludes.end())
                 {
-                    const bool SystemHeader(line.find("<") != std::string::npos);
+                    addtoken(SystemHeader ? "#include<>" : "#include", lineno, FileIndex);
+                    addtoken(header.c_str(), lineno, FileIndex);
 
-                    // Extract the filename
-                    line.erase(0, line.find_first_of("<\"")+1);
-                    line.erase(line.find_first_of(">\""));
-
-                    if (skipIncludes.find(line) == skipIncludes.end())
+                    const bool found(tokenize(header.c_str(), getIncludePaths(FileIndex, includePaths),
+                                              skipIncludes, pOptions, errout));
+                    addInclude(FileIndex, lineno, header, SystemHeader, found);
+                    if (!found && !pOptions->IgnoreMissingIncludeFile)
                     {
-                        // Add path for current file to the include paths..
-                        std::vector<std::string> incpaths;
-                        if (FullFileNames[FileIndex].find_first_of("\\/") != std::string::npos)
-                        {
-                            std::string path = FullFileNames[FileIndex];
-                            path.erase(1 + path.find_last_of("\\/"));
-                            incpaths.push_back(path);
-                        }
-                        std::copy(includePaths.begin(), includePaths.end(), std::back_inserter(incpaths));
-
-                        addtoken(SystemHeader ? "#include<>" : "#include", lineno, FileIndex);
-                        addtoken(line.c_str(), lineno, FileIndex);
-
-                        const bool found(tokenize(line.c_str(), incpaths,
-                                                  skipIncludes, pOptions, errout));
-                        if (!found && !pOptions->IgnoreMissingIncludeFile)
-                        {
-                            free(tokens_back->str);
-                            tokens_back->str = strdup("not found");
-                            const std::string errmsg("Header not found '" + line + "'. Use -I or --skip to fix this message.");
-                            ReportErr(pOptions->outputFormat, FullFileNames[FileIndex],
-                                      lineno, "HeaderNotFound", errmsg, errout);
-                        }
+                        free(tokens_back->str);
+                        tokens_back->str = strdup("not found");
+                        headerNotFound(header, FileIndex, lineno, pOptions, errout);
                     }
                 }
                 ++lineno;
@@ -502,4 +707,17 @@ const char *getstr(const Token *tok, int offset)
 }
 //---------------------------------------------------------------------------
 
+FileHash hashContents(const std::string &data)
+{
+    // FNV-1a
+    FileHash hash = 14695981039346656037ULL;
+    for (std::string::size_type i = 0; i < data.size(); ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+//---------------------------------------------------------------------------
+
 
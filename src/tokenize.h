@@ -21,8 +21,10 @@
 #define tokenizeH
 //---------------------------------------------------------------------------
 
+#include <ostream>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 enum OutputFormat
@@ -32,12 +34,26 @@ enum OutputFormat
     OUTPUT_FORMAT_VS
 };
 
-typedef struct {
-  bool Debug;                    // --debug
-  OutputFormat outputFormat;     // --xml
-  bool Progress;                 // --quiet
-  bool IgnoreMissingIncludeFile; // --skip-all
-} Options;
+struct Options
+{
+    Options()
+        : Debug(false), outputFormat(OUTPUT_FORMAT_NORMAL), Progress(true),
+          IgnoreMissingIncludeFile(false), ResolveOnly(false), Incremental(false),
+          IncludeCost(false)
+    { }
+
+    bool Debug;                    // --debug
+    OutputFormat outputFormat;     // --xml
+    bool Progress;                 // --quiet
+    bool IgnoreMissingIncludeFile; // --skip-all
+    bool ResolveOnly;              // --resolve-only
+    bool Incremental;              // --incremental
+    bool IncludeCost;              // --include-cost
+    std::set<std::string> EnabledChecks; // --enable
+};
+
+// Hash of file contents. Files with the same hash are considered identical.
+typedef unsigned long long FileHash;
 
 struct Token
 {
@@ -52,6 +68,25 @@ class Tokenizer
 private:
     struct Token * tokens_back;
 
+    enum FileStatus { FILE_NOT_FOUND, FILE_KNOWN, FILE_NEW };
+
+    // Find, read and register a file. The data is only read for new files.
+    FileStatus addFile(const char FileName[],
+                       const std::vector<std::string> &includePaths,
+                       std::string &data);
+
+    // Search paths for files included by the given file
+    std::vector<std::string> getIncludePaths(const unsigned int FileIndex,
+                                             const std::vector<std::string> &includePaths) const;
+
+    // Remember a resolved #include directive
+    void addInclude(const unsigned int FileIndex, const unsigned int lineno,
+                    const std::string &header, bool SystemHeader, bool found);
+
+    void headerNotFound(const std::string &header, const unsigned int FileIndex,
+                        const unsigned int lineno, const Options *pOptions,
+                        std::ostream &errout) const;
+
     void tokenizeCode(std::istream &code, const unsigned int FileIndex,
                       const std::vector<std::string> &includePaths,
                       const std::set<std::string> &skipIncludes,
@@ -77,9 +112,64 @@ public:
                   const std::set<std::string> &skipIncludes,
                   const Options *pOptions, std::ostream &errout);
 
+    /**
+     * resolve the #include directives of a file recursively without
+     * tokenizing it. Missing headers are reported. No tokens are created
+     * but the file names are registered like in tokenize.
+     * @param FileName file name
+     * @param includePaths search paths for the file
+     * @param skipIncludes skip #include that match
+     * @param pOptions options
+     * @param errout error stream
+     */
+    bool scanIncludes(const char FileName[],
+                      const std::vector<std::string> &includePaths,
+                      const std::set<std::string> &skipIncludes,
+                      const Options *pOptions, std::ostream &errout);
+
+    /**
+     * find a file like the #include directive does. The file name is
+     * tried as it is first and then in the include paths.
+     * @param FileName file name as it is written in the #include
+     * @param includePaths search paths for the file
+     * @return path of the file. Empty if it is not found
+     */
+    static std::string findFile(const char FileName[],
+                                const std::vector<std::string> &includePaths);
+
+    /**
+     * get index of a tokenized file
+     * @param ShortFileName file name as it is written in the #include
+     * @return file index. ShortFileNames.size() if the file is not found
+     */
+    unsigned int getFileIndex(const char ShortFileName[]) const;
+
     struct Token * tokens;
     std::vector<std::string> FullFileNames;
     std::vector<std::string> ShortFileNames;
+    std::vector<FileHash> FileHashes;
+    std::vector<unsigned int> FileSizes;
+    std::vector<unsigned int> FileTokens;   // number of tokens in each file
+
+    // Files that are identical to an already tokenized file. They are
+    // not tokenized again, instead they share the file index.
+    std::vector< std::pair<std::string, unsigned int> > FileAliases;
+    std::vector<std::string> AliasFullFileNames;
+
+    // The include paths of the checked source file
+    std::vector<std::string> IncludePaths;
+
+    // An #include directive that is not skipped
+    struct IncludeDirective
+    {
+        unsigned int FileIndex;   // file that contains the #include
+        unsigned int linenr;
+        std::string header;       // header name as it is written
+        bool SystemHeader;        // #include <..>
+        unsigned int target;      // index of the included file
+        std::string path;         // path of the included file. Empty if it is not found
+    };
+    std::vector<IncludeDirective> Includes;
 };
 
 
@@ -87,6 +177,9 @@ public:
 const Token *gettok(const Token *tok, int index);
 const char *getstr(const Token *tok, int index);
 
+// Calculate hash for file contents
+FileHash hashContents(const std::string &data);
+
 
 //---------------------------------------------------------------------------
 #endif
@@ -18,11 +18,34 @@
 
 #include "tokenize.h"
 #include "checkheaders.h"
+#include "check.h"
+#include "filelister.h"
+#include "fixit.h"
+#include "headerusage.h"
+#include "includegraph.h"
+#include "symbolcache.h"
 #include "testsuite.h"
 #include <fstream>
 #include <sstream>
 #include <vector>
 
+#if defined(__GNUC__) && !defined(__MINGW32__)
+#include <sys/stat.h>
+#endif
+#if defined(__BORLANDC__) || defined(_MSC_VER) || defined(__MINGW32__)
+#include <windows.h>
+#endif
+
+// Create a directory for the files of a test
+static void createDirectory(const char path[])
+{
+#if defined(__GNUC__) && !defined(__MINGW32__)
+    mkdir(path, 0777);
+#else
+    CreateDirectoryA(path, NULL);
+#endif
+}
+
 class TestWarningIncludeHeaders : public TestFixture
 {
 public:
@@ -35,12 +58,34 @@ private:
 
     void run()
     {
+        TEST_CASE(affectedfiles);
+        TEST_CASE(checkedincludes);
+        TEST_CASE(cycle1);
+        TEST_CASE(deadheaders);
         TEST_CASE(declaration1);
         TEST_CASE(declaration2);
+        TEST_CASE(enablecheck);
+        TEST_CASE(exportgraph);
+        TEST_CASE(fingerprint);
+        TEST_CASE(fixfiles);
+        TEST_CASE(fixit);
+        TEST_CASE(fixitmismatch);
+        TEST_CASE(fixitnewline);
+        TEST_CASE(headersplit);
+        TEST_CASE(headerweight);
+        TEST_CASE(identical1);
+        TEST_CASE(identical2);
         TEST_CASE(implementation1);
         TEST_CASE(implementation2);
+        TEST_CASE(includecost);
+        TEST_CASE(includegraph);
+        TEST_CASE(includegraphalias);
+        TEST_CASE(includeset);
+        TEST_CASE(includesetpath);
+        TEST_CASE(incrementalkey);
         TEST_CASE(indentlevel);
         TEST_CASE(issue3);
+        TEST_CASE(missingsymbols);
         TEST_CASE(needed_class);
         TEST_CASE(needed_const);
         TEST_CASE(needed_define1);
@@ -48,12 +93,201 @@ private:
         TEST_CASE(needed_include);
         TEST_CASE(needed_typedef);
         TEST_CASE(needed_namespace);
+        TEST_CASE(precompiledheader);
+        TEST_CASE(precompiledheadercost);
+        TEST_CASE(redundant);
+        TEST_CASE(resolveonly);
         TEST_CASE(stdafx);
+        TEST_CASE(symbolcache);
+        TEST_CASE(symboldatabase);
         TEST_CASE(standardheader1);
         TEST_CASE(standardheader2);
         TEST_CASE(test1);
     }
 
+    void affectedfiles()
+    {
+        createDirectory("affectedfiles");
+        {
+            std::ofstream f1("affectedfiles1.c");
+            f1 << "#include \"affectedfiles.h\"\n";
+
+            std::ofstream f2("affectedfiles2.c");
+            f2 << "void f();\n";
+
+            std::ofstream f3("affectedfiles.h");
+            f3 << "void foo();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        IncludeGraph graph;
+        const char *sources[] = { "affectedfiles1.c", "affectedfiles2.c" };
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize(sources[i], includePaths, skipIncludes, &UserOption, errout);
+            graph.add(tokenizer);
+        }
+
+        // affectedfiles3.c is not in the graph, it is new
+        std::vector<std::string> filenames(sources, sources + 2);
+        filenames.push_back("affectedfiles3.c");
+
+        // The changed header is found with other paths..
+        std::vector<std::string> changed(1, "affectedfiles/../affectedfiles.h");
+        unsigned int matched = 0;
+        std::vector<std::string> affected(graph.affectedFiles(filenames, changed, matched));
+        ASSERT_EQUALS(1, (int)matched);
+        ASSERT_EQUALS(2, (int)affected.size());
+        ASSERT_EQUALS("affectedfiles1.c", affected.empty() ? "" : affected[0]);
+
+        changed[0] = FileLister::absolutePath("affectedfiles.h");
+        affected = graph.affectedFiles(filenames, changed, matched);
+        ASSERT_EQUALS(1, (int)matched);
+        ASSERT_EQUALS(2, (int)affected.size());
+
+        // ..and changes of other files don't match
+        changed[0] = "affectedfiles/readme.txt";
+        affected = graph.affectedFiles(filenames, changed, matched);
+        ASSERT_EQUALS(0, (int)matched);
+        ASSERT_EQUALS(1, (int)affected.size());
+        ASSERT_EQUALS("affectedfiles3.c", affected.empty() ? "" : affected[0]);
+    }
+
+    void checkedincludes()
+    {
+        {
+            std::ofstream f1("checkedincludes.c");
+            f1 << "#include \"checkedincludes1.h\"\n"
+               << "void f() { a(); }\n";
+
+            std::ofstream f2("checkedincludes1.h");
+            f2 << "#include \"checkedincludes2.h\"\n"
+               << "void a();\n";
+
+            std::ofstream f3("checkedincludes2.h");
+            f3 << "void b();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("checkedincludes.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // The includes in the header are checked..
+        std::set<std::string> checkedIncludes;
+        WarningIncludeHeader(tokenizer, &UserOption, errout, NULL, &checkedIncludes);
+        ASSERT_EQUALS("[checkedincludes1.h:1] (style): The included header 'checkedincludes2.h' is not needed\n", errout.str());
+        ASSERT_EQUALS(1, (int)checkedIncludes.size());
+
+        // ..and they are not checked again
+        errout.str("");
+        UserOption.outputFormat = OUTPUT_FORMAT_VS;
+        WarningIncludeHeader(tokenizer, &UserOption, errout, NULL, &checkedIncludes);
+        ASSERT_EQUALS("", errout.str());
+
+        WarningIncludeHeader(tokenizer, &UserOption, errout);
+        ASSERT_EQUALS("checkedincludes1.h(1) (style): The included header 'checkedincludes2.h' is not needed\n", errout.str());
+    }
+
+    void cycle1()
+    {
+        // Headers that include each other
+        {
+            std::ofstream f1("cycle1.c");
+            f1 << "#include \"cycle1a.h\"\n"
+               << "void f() { b(); }\n";
+
+            std::ofstream f2("cycle1a.h");
+            f2 << "#include \"cycle1b.h\"\n";
+
+            std::ofstream f3("cycle1b.h");
+            f3 << "#include \"cycle1a.h\"\n"
+               << "#include <cycle1c.h>\n"
+               << "void b();\n";
+
+            std::ofstream f4("cycle1c.h");
+            f4 << "void c();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("cycle1.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // Including header which is not needed
+        WarningIncludeHeader(tokenizer, &UserOption, errout);
+
+        ASSERT_EQUALS("[cycle1.c:1] (style): Inconclusive results: The included header 'cycle1a.h' is not needed. "
+                      "However it is needed indirectly because it includes 'cycle1b.h'. "
+                      "If it is included by intention use '--skip cycle1a.h' to remove false positives.\n"
+                      "[cycle1a.h:1] (style): The included header 'cycle1b.h' is not needed\n"
+                      "[cycle1b.h:1] (style): Inconclusive results: The included header 'cycle1a.h' is not needed. "
+                      "However it is needed indirectly because it includes 'cycle1b.h'. "
+                      "If it is included by intention use '--skip cycle1a.h' to remove false positives.\n"
+                      "[cycle1b.h:2] (style): The included header 'cycle1c.h' is not needed\n", errout.str());
+    }
+
+    void deadheaders()
+    {
+        {
+            std::ofstream f1("deadheaders1.c");
+            f1 << "#include \"deadheaders1.h\"\n"
+               << "#include \"deadheaders2.h\"\n";
+
+            std::ofstream f2("deadheaders2.c");
+            f2 << "#include \"deadheaders1.h\"\n";
+
+            std::ofstream f3("deadheaders1.h");
+            f3 << "void foo();\n";
+
+            std::ofstream f4("deadheaders2.h");
+            f4 << "void bar();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        // deadheaders1.h is not needed in either source file..
+        std::set<std::string> unneededIncludes;
+        unneededIncludes.insert("deadheaders1.c:1");
+        unneededIncludes.insert("deadheaders2.c:1");
+
+        IncludeGraph graph;
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize("deadheaders1.c", includePaths, skipIncludes, &UserOption, errout);
+            graph.add(tokenizer, &unneededIncludes);
+        }
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize("deadheaders2.c", includePaths, skipIncludes, &UserOption, errout);
+            graph.add(tokenizer, &unneededIncludes);
+        }
+
+        // ..deadheaders2.h is needed and deadheaders3.h is not included at all
+        const std::vector<IncludeGraph::DeadHeader> dead(graph.deadHeaders(std::vector<std::string>(1, "deadheaders3.h")));
+        ASSERT_EQUALS(2, (int)dead.size());
+        if (dead.size() == 2)
+        {
+            ASSERT_EQUALS("deadheaders1.h", dead[0].path);
+            ASSERT_EQUALS(2, (int)dead[0].includeSites);
+            ASSERT_EQUALS(2, (int)dead[0].includers);
+            ASSERT_EQUALS(10, (int)dead[0].savedTokens);
+
+            ASSERT_EQUALS("deadheaders3.h", dead[1].path);
+            ASSERT_EQUALS(0, (int)dead[1].includeSites);
+        }
+    }
+
     void declaration1()
     {
         // Header is not needed
@@ -120,6 +354,389 @@ private:
         ASSERT_EQUALS("", errout.str());
     }
 
+    void fixfiles()
+    {
+        {
+            std::ofstream f1("fixfiles2.c");
+            f1 << "#include \"fixfiles1.h\"\n"
+               << "#include \"fixfiles0.h\"\n"
+               << "Fred fred;\n";
+
+            std::ofstream f2("fixfiles0.h");
+            f2 << "int unused;\n";
+
+            std::ofstream f3("fixfiles1.h");
+            f3 << "#include \"fixfiles3.h\"\n"
+               << "#include \"fixfiles0.h\"\n";
+
+            std::ofstream f4("fixfiles3.h");
+            f4 << "struct Fred { };\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("fixfiles2.c", includePaths, skipIncludes, &UserOption, errout);
+
+        IncludeGraph graph;
+        graph.add(tokenizer);
+
+        // The header is sorted before the source file but it is fixed after it,
+        // and the removal of the include that declares Fred is undone..
+        FixIts fixIts;
+        fixIts.replaceLine("fixfiles1.h", 1, "fixfiles3.h", std::vector<std::string>());
+        fixIts.replaceLine("fixfiles1.h", 2, "fixfiles0.h", std::vector<std::string>());
+        fixIts.replaceLine("fixfiles2.c", 2, "fixfiles0.h", std::vector<std::string>());
+
+        std::ostringstream out;
+        ASSERT(fixIts.fix(graph, std::vector<std::string>(1, "fixfiles2.c"), includePaths, skipIncludes, out));
+        ASSERT_EQUALS("Fixed 1 of 1 includes in fixfiles2.c\n"
+                      "Undoing the fix of fixfiles1.h:1 (fixfiles2.c:Fred is not declared)\n"
+                      "Fixed 1 of 2 includes in fixfiles1.h\n", out.str());
+
+        std::ifstream fin1("fixfiles1.h");
+        std::ostringstream header;
+        header << fin1.rdbuf();
+        ASSERT_EQUALS("#include \"fixfiles3.h\"\n", header.str());
+
+        std::ifstream fin2("fixfiles2.c");
+        std::ostringstream source;
+        source << fin2.rdbuf();
+        ASSERT_EQUALS("#include \"fixfiles1.h\"\nFred fred;\n", source.str());
+    }
+
+    void fixit()
+    {
+        {
+            std::ofstream f1("fixit.c");
+            f1 << "#include \"fixit.h\"\n"
+               << "void f(Fred *fred);\n";
+
+            std::ofstream f2("fixit.h");
+            f2 << "namespace NS {\n"
+               << "struct Fred\n"
+               << "{\n"
+               << "};\n"
+               << "}\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("fixit.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // The include is replaced by a forward declaration..
+        FixIts fixIts;
+        WarningIncludeHeader(tokenizer, &UserOption, errout, NULL, NULL, &fixIts);
+        ASSERT_EQUALS("[fixit.c:1] (style): The included header 'fixit.h' is not needed (but forward declaration is needed)\n", errout.str());
+
+        std::ostringstream diff;
+        std::ostringstream warnings;
+        ASSERT(fixIts.writeDiff(diff, warnings));
+        ASSERT_EQUALS("", warnings.str());
+        ASSERT_EQUALS("--- fixit.c\n"
+                      "+++ fixit.c\n"
+                      "@@ -1,2 +1,2 @@\n"
+                      "-#include \"fixit.h\"\n"
+                      "+namespace NS { struct Fred; }\n"
+                      " void f(Fred *fred);\n", diff.str());
+
+        // The fix can be applied to the contents..
+        const std::vector<unsigned int> linenrs(fixIts.getLines("fixit.c"));
+        ASSERT_EQUALS(1, (int)linenrs.size());
+        ASSERT_EQUALS("namespace NS { struct Fred; }\nvoid f(Fred *fred);\n",
+                      fixIts.apply("fixit.c", "#include \"fixit.h\"\nvoid f(Fred *fred);\n", linenrs));
+    }
+
+    void fixitmismatch()
+    {
+        // The string continues on the next line, the line of the include is counted wrong
+        {
+            std::ofstream f1("fixitmismatch.c");
+            f1 << "const char *s = \"abc\\\n"
+               << "def\";\n"
+               << "int keep_me;\n"
+               << "#include \"fixitmismatch.h\"\n"
+               << "void f() { }\n";
+
+            std::ofstream f2("fixitmismatch.h");
+            f2 << "int a;\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("fixitmismatch.c", includePaths, skipIncludes, &UserOption, errout);
+
+        FixIts fixIts;
+        WarningIncludeHeader(tokenizer, &UserOption, errout, NULL, NULL, &fixIts);
+
+        // The line is not the #include so it is not changed in the diff
+        std::ostringstream diff;
+        std::ostringstream warnings;
+        ASSERT(fixIts.writeDiff(diff, warnings));
+        ASSERT_EQUALS("", diff.str());
+        ASSERT_EQUALS("checkheaders: fixitmismatch.c:3 is not the #include of 'fixitmismatch.h', it is not fixed\n", warnings.str());
+
+        // ..and the fix is not applied
+        const std::string contents("const char *s = \"abc\\\ndef\";\nint keep_me;\n#include \"fixitmismatch.h\"\nvoid f() { }\n");
+        warnings.str("");
+        ASSERT_EQUALS(0, (int)fixIts.getValidLines("fixitmismatch.c", contents, warnings).size());
+        ASSERT_EQUALS("checkheaders: fixitmismatch.c:3 is not the #include of 'fixitmismatch.h', it is not fixed\n", warnings.str());
+        ASSERT_EQUALS(contents, fixIts.apply("fixitmismatch.c", contents, fixIts.getLines("fixitmismatch.c")));
+    }
+
+    void fixitnewline()
+    {
+        // The replaced include is the last line and it has no newline
+        {
+            std::ofstream f1("fixitnewline.c");
+            f1 << "void f();\n"
+               << "#include \"fixitnewline.h\"";
+        }
+
+        FixIts fixIts;
+        fixIts.replaceLine("fixitnewline.c", 2, "fixitnewline.h", std::vector<std::string>(1, "struct Fred;"));
+
+        std::ostringstream diff;
+        std::ostringstream warnings;
+        ASSERT(fixIts.writeDiff(diff, warnings));
+        ASSERT_EQUALS("", warnings.str());
+        ASSERT_EQUALS("--- fixitnewline.c\n"
+                      "+++ fixitnewline.c\n"
+                      "@@ -1,2 +1,2 @@\n"
+                      " void f();\n"
+                      "-#include \"fixitnewline.h\"\n"
+                      "\\ No newline at end of file\n"
+                      "+struct Fred;\n"
+                      "\\ No newline at end of file\n", diff.str());
+
+        // ..and the fixed file has no newline at the end either
+        const std::vector<unsigned int> linenrs(fixIts.getLines("fixitnewline.c"));
+        ASSERT_EQUALS("void f();\nstruct Fred;",
+                      fixIts.apply("fixitnewline.c", "void f();\n#include \"fixitnewline.h\"", linenrs));
+    }
+
+    void headersplit()
+    {
+        {
+            std::ofstream f1("headersplit1.c");
+            f1 << "#include \"headersplit.h\"\n"
+               << "void f() { log(); }\n";
+
+            std::ofstream f2("headersplit2.c");
+            f2 << "#include \"headersplit.h\"\n"
+               << "void g() { Config config; loadConfig(&config); }\n";
+
+            std::ofstream f3("headersplit.h");
+            f3 << "void log();\n"
+               << "struct Config { int a; };\n"
+               << "void loadConfig(Config *config);\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        HeaderUsage headerUsage;
+        const CheckContext context(&UserOption, NULL, NULL, NULL, NULL, &headerUsage);
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize("headersplit1.c", includePaths, skipIncludes, &UserOption, errout);
+            runChecks(tokenizer, context, errout);
+        }
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize("headersplit2.c", includePaths, skipIncludes, &UserOption, errout);
+            runChecks(tokenizer, context, errout);
+        }
+
+        // The source files use different symbols of the header..
+        const std::vector<HeaderUsage::Split> splits(headerUsage.suggestSplits());
+        ASSERT_EQUALS(1, (int)splits.size());
+        if (splits.size() == 1)
+        {
+            ASSERT_EQUALS("headersplit.h", splits[0].path);
+            ASSERT_EQUALS(2, (int)splits[0].includers);
+            ASSERT_EQUALS(2, (int)splits[0].parts.size());
+            if (splits[0].parts.size() == 2)
+            {
+                ASSERT_EQUALS(2, (int)splits[0].parts[0].size());
+                ASSERT_EQUALS("Config", splits[0].parts[0][0]);
+                ASSERT_EQUALS("loadConfig", splits[0].parts[0][1]);
+                ASSERT_EQUALS(1, (int)splits[0].parts[1].size());
+                ASSERT_EQUALS("log", splits[0].parts[1][0]);
+            }
+        }
+
+        // ..but not when one file uses symbols of both groups
+        {
+            std::ofstream f1("headersplit1.c");
+            f1 << "#include \"headersplit.h\"\n"
+               << "void f() { log(); loadConfig(0); }\n";
+        }
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize("headersplit1.c", includePaths, skipIncludes, &UserOption, errout);
+            runChecks(tokenizer, context, errout);
+        }
+        ASSERT_EQUALS(0, (int)headerUsage.suggestSplits().size());
+    }
+
+    void headerweight()
+    {
+        {
+            std::ofstream f1("headerweight1.c");
+            f1 << "#include \"headerweight1.h\"\n";
+
+            std::ofstream f2("headerweight2.c");
+            f2 << "#include \"headerweight2.h\"\n";
+
+            std::ofstream f3("headerweight1.h");
+            f3 << "#include \"headerweight2.h\"\n"
+               << "void foo();\n";
+
+            std::ofstream f4("headerweight2.h");
+            f4 << "void bar();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        IncludeGraph graph;
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize("headerweight1.c", includePaths, skipIncludes, &UserOption, errout);
+            graph.add(tokenizer);
+        }
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize("headerweight2.c", includePaths, skipIncludes, &UserOption, errout);
+            graph.add(tokenizer);
+        }
+
+        // headerweight1.h costs more in total although headerweight2.h is included by both source files..
+        const std::vector<IncludeGraph::HeaderWeight> weights(graph.headerWeights());
+        ASSERT_EQUALS(2, (int)weights.size());
+        if (weights.size() == 2)
+        {
+            ASSERT_EQUALS("headerweight1.h", weights[0].path);
+            ASSERT_EQUALS(2, (int)weights[0].closureFiles);
+            ASSERT_EQUALS(12, (int)weights[0].closureTokens);
+            ASSERT_EQUALS(12, (int)weights[0].totalTokens);
+
+            ASSERT_EQUALS("headerweight2.h", weights[1].path);
+            ASSERT_EQUALS(1, (int)weights[1].directIncluders);
+            ASSERT_EQUALS(2, (int)weights[1].includers);
+            ASSERT_EQUALS(5, (int)weights[1].tokens);
+            ASSERT_EQUALS(1, (int)weights[1].closureFiles);
+            ASSERT_EQUALS(10, (int)weights[1].totalTokens);
+        }
+    }
+
+    void identical1()
+    {
+        // Identical headers are only tokenized once
+        {
+            std::ofstream f1("identical1.c");
+            f1 << "#include \"identical1a.h\"\n"
+               << "#include \"identical1b.h\"\n";
+
+            std::ofstream f2("identical1a.h");
+            f2 << "void foo();\n";
+
+            std::ofstream f3("identical1b.h");
+            f3 << "void foo();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+
+        UserOption.Debug = false;
+        UserOption.Progress = false;
+        UserOption.IgnoreMissingIncludeFile = false;
+        UserOption.outputFormat = OUTPUT_FORMAT_NORMAL;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("identical1.c", includePaths, skipIncludes, &UserOption, errout);
+        ASSERT_EQUALS(2, tokenizer.ShortFileNames.size());
+        ASSERT_EQUALS(1, tokenizer.getFileIndex("identical1b.h"));
+
+        // Including header which is not needed
+        WarningIncludeHeader(tokenizer, &UserOption, errout);
+
+        ASSERT_EQUALS("[identical1.c:1] (style): The included header 'identical1a.h' is not needed\n"
+                      "[identical1.c:2] (style): The included header 'identical1b.h' is not needed\n", errout.str());
+    }
+
+    void identical2()
+    {
+        // Symbols are found in the shared header
+        {
+            std::ofstream f1("identical2.c");
+            f1 << "#include \"identical2a.h\"\n"
+               << "#include \"identical2b.h\"\n"
+               << "void f() { foo(); }\n";
+
+            std::ofstream f2("identical2a.h");
+            f2 << "void foo();\n";
+
+            std::ofstream f3("identical2b.h");
+            f3 << "void foo();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+
+        UserOption.Debug = false;
+        UserOption.Progress = false;
+        UserOption.IgnoreMissingIncludeFile = false;
+        UserOption.outputFormat = OUTPUT_FORMAT_NORMAL;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("identical2.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // Including header which is not needed
+        WarningIncludeHeader(tokenizer, &UserOption, errout);
+
+        ASSERT_EQUALS("", errout.str());
+    }
+
+    void enablecheck()
+    {
+        {
+            std::ofstream f1("enablecheck.c");
+            f1 << "#include \"enablecheck.h\"\n"
+               << "void f() { a(); }\n";
+
+            std::ofstream f2("enablecheck.h");
+            f2 << "inline void a() { }\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("enablecheck.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // The implementation check is not enabled by default..
+        const CheckContext context(&UserOption, NULL, NULL);
+        runChecks(tokenizer, context, errout);
+        ASSERT_EQUALS("", errout.str());
+
+        UserOption.EnabledChecks.insert("implementation");
+        runChecks(tokenizer, context, errout);
+        ASSERT_EQUALS("[enablecheck.h:1] (style): Found implementation in header\n", errout.str());
+    }
+
     void implementation1()
     {
         // Call function in header
@@ -187,6 +804,267 @@ private:
         ASSERT_EQUALS("[implementation2.c:1] (style): The included header 'implementation2.h' is not needed\n", errout.str());
     }
 
+    void includecost()
+    {
+        {
+            std::ofstream f1("includecost.c");
+            f1 << "#include \"includecost1.h\"\n"
+               << "#include \"includecost2.h\"\n";
+
+            std::ofstream f2("includecost1.h");
+            f2 << "#include \"includecost3.h\"\n"
+               << "void foo();\n";
+
+            std::ofstream f3("includecost2.h");
+            f3 << "#include \"includecost3.h\"\n";
+
+            std::ofstream f4("includecost3.h");
+            f4 << "void bar();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+        UserOption.IncludeCost = true;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("includecost.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // includecost3.h is still included by includecost2.h when includecost1.h is removed..
+        WarningIncludeHeader(tokenizer, &UserOption, errout);
+        ASSERT_EQUALS("[includecost.c:1] (style): The included header 'includecost1.h' is not needed (cost: 1 files, 38 bytes, 7 tokens)\n"
+                      "[includecost.c:2] (style): The included header 'includecost2.h' is not needed (cost: 1 files, 26 bytes, 2 tokens)\n"
+                      "[includecost1.h:1] (style): The included header 'includecost3.h' is not needed (cost: 0 files, 0 bytes, 0 tokens)\n"
+                      "[includecost2.h:1] (style): The included header 'includecost3.h' is not needed (cost: 0 files, 0 bytes, 0 tokens)\n", errout.str());
+    }
+
+    void includegraph()
+    {
+        {
+            std::ofstream f1("includegraph.c");
+            f1 << "#include \"includegraph1.h\"\n"
+               << "#include <includegraph3.h>\n";
+
+            std::ofstream f2("includegraph1.h");
+            f2 << "#include \"includegraph2.h\"\n";
+
+            std::ofstream f3("includegraph2.h");
+            f3 << "void foo();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("includegraph.c", includePaths, skipIncludes, &UserOption, errout);
+
+        IncludeGraph graph;
+        graph.add(tokenizer);
+        ASSERT(graph.save("includegraph.txt"));
+
+        // The queries are answered by the loaded graph..
+        IncludeGraph loaded;
+        ASSERT(loaded.load("includegraph.txt"));
+        ASSERT_EQUALS(3, (int)loaded.getFiles().size());
+
+        std::vector<std::string> files(loaded.whoIncludes("includegraph2.h", false));
+        ASSERT_EQUALS(1, (int)files.size());
+        ASSERT_EQUALS("includegraph1.h", files.empty() ? "" : files[0]);
+
+        files = loaded.whoIncludes("includegraph2.h", true);
+        ASSERT_EQUALS(2, (int)files.size());
+        ASSERT_EQUALS("includegraph.c", files.empty() ? "" : files[0]);
+
+        files = loaded.dependencies("includegraph.c");
+        ASSERT_EQUALS(2, (int)files.size());
+        ASSERT_EQUALS("includegraph2.h", files.size() < 2 ? "" : files[1]);
+
+        // The system header is not found but the include is remembered..
+        const IncludeGraph::File &source = loaded.getFiles().find("includegraph.c")->second;
+        ASSERT(source.source);
+        ASSERT_EQUALS(2, (int)source.includes.size());
+        ASSERT_EQUALS("<includegraph3.h>", source.includes.size() < 2 ? "" : source.includes[1].header);
+    }
+
+    void includegraphalias()
+    {
+        // The headers in the directories are identical but they include
+        // different files..
+        createDirectory("includegraphalias1");
+        createDirectory("includegraphalias2");
+        {
+            std::ofstream f1("includegraphalias.c");
+            f1 << "#include \"includegraphalias1/common.h\"\n"
+               << "#include \"includegraphalias2/common.h\"\n";
+
+            std::ofstream f2("includegraphalias1/common.h");
+            f2 << "#include \"local.h\"\n";
+
+            std::ofstream f3("includegraphalias2/common.h");
+            f3 << "#include \"local.h\"\n";
+
+            std::ofstream f4("includegraphalias1/local.h");
+            f4 << "void foo();\n";
+
+            std::ofstream f5("includegraphalias2/local.h");
+            f5 << "#include \"types.h\"\n"
+               << "void bar();\n";
+
+            std::ofstream f6("includegraphalias2/types.h");
+            f6 << "typedef int size;\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("includegraphalias.c", includePaths, skipIncludes, &UserOption, errout);
+
+        IncludeGraph graph;
+        graph.add(tokenizer);
+
+        // ..the identical header has its own includes in the graph
+        const std::vector<std::string> files(graph.dependencies("includegraphalias.c"));
+        ASSERT_EQUALS(5, (int)files.size());
+        ASSERT_EQUALS("includegraphalias2/local.h", files.size() < 5 ? "" : files[3]);
+        ASSERT_EQUALS("includegraphalias2/types.h", files.size() < 5 ? "" : files[4]);
+
+        const std::map<std::string, IncludeGraph::File>::const_iterator common = graph.getFiles().find("includegraphalias2/common.h");
+        ASSERT(common != graph.getFiles().end());
+        if (common != graph.getFiles().end())
+        {
+            ASSERT_EQUALS(1, (int)common->second.includes.size());
+            ASSERT_EQUALS("includegraphalias2/local.h", common->second.includes.empty() ? "" : common->second.includes[0].path);
+        }
+    }
+
+    void includeset()
+    {
+        {
+            std::ofstream f1("includeset.c");
+            f1 << "#include \"includeset1.h\"\n"
+               << "void f() { Log log; }\n";
+
+            std::ofstream f2("includeset1.h");
+            f2 << "#include \"includeset2.h\"\n"
+               << "#include \"includeset3.h\"\n";
+
+            std::ofstream f3("includeset2.h");
+            f3 << "class Log { };\n";
+
+            std::ofstream f4("includeset3.h");
+            f4 << "struct Config { int a; int b; };\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("includeset.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // Log is only needed from the umbrella header, the header that declares it is cheaper
+        UserOption.EnabledChecks.insert("includeset");
+        const CheckContext context(&UserOption, NULL, NULL);
+        runChecks(tokenizer, context, errout);
+        const std::string errors(errout.str());
+        const std::string::size_type pos = errors.find("[includeset.c:1] (style): Cheaper");
+        ASSERT(pos != std::string::npos);
+        if (pos != std::string::npos)
+            ASSERT_EQUALS("[includeset.c:1] (style): Cheaper includes provide the needed symbols: include 'includeset2.h' instead of 'includeset1.h' (saves 15 of 20 tokens)\n", errors.substr(pos));
+    }
+
+    void includesetpath()
+    {
+        {
+            std::ofstream f1("includesetpath.c");
+            f1 << "#include \"includesetpath1.h\"\n"
+               << "void f() { Log log; }\n";
+
+            std::ofstream f2("includesetpath1.h");
+            f2 << "#include \"includesetpath2.h\"\n"
+               << "#include \"includesetpath3.h\"\n";
+
+            std::ofstream f3("includesetpath2.h");
+            f3 << "class Log { };\n";
+
+            std::ofstream f4("includesetpath3.h");
+            f4 << "struct Config { int a; int b; };\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("includesetpath.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // The source file is in another directory, the header that declares
+        // Log is not found by its name from there
+        tokenizer.FullFileNames[0] = "includesetpath/includesetpath.c";
+
+        UserOption.EnabledChecks.insert("includeset");
+        const CheckContext context(&UserOption, NULL, NULL);
+        runChecks(tokenizer, context, errout);
+        ASSERT_EQUALS(std::string::npos, errout.str().find("Cheaper"));
+    }
+
+    void incrementalkey()
+    {
+        {
+            std::ofstream f1("incrementalkey.c");
+            f1 << "#include \"incrementalkey.h\"\n"
+               << "void f() { foo(); }\n";
+
+            std::ofstream f2("incrementalkey.h");
+            f2 << "void foo();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        // The header is summarized when the source file is checked..
+        SymbolCache symbolCache;
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize("incrementalkey.c", includePaths, skipIncludes, &UserOption, errout);
+            WarningIncludeHeader(tokenizer, &UserOption, errout, &symbolCache);
+        }
+        const std::set<std::string> ownHeaders;
+        Tokenizer scanned1;
+        scanned1.scanIncludes("incrementalkey.c", includePaths, skipIncludes, &UserOption, errout);
+        const FileHash key = symbolCache.resultsKey(scanned1, ownHeaders, &UserOption, skipIncludes);
+        ASSERT(key != 0);
+
+        // ..a change that doesn't touch the interface of the header keeps
+        // the key once the new contents are summarized, so the results of
+        // the first source file that includes it can be reused
+        {
+            std::ofstream f2("incrementalkey.h", std::ios::app);
+            f2 << "// comment\n";
+        }
+        Tokenizer scanned2;
+        scanned2.scanIncludes("incrementalkey.c", includePaths, skipIncludes, &UserOption, errout);
+        ASSERT(symbolCache.resultsKey(scanned2, ownHeaders, &UserOption, skipIncludes) == 0);
+        SummarizeHeaders(scanned2, includePaths, skipIncludes, &UserOption, &symbolCache);
+        ASSERT(symbolCache.resultsKey(scanned2, ownHeaders, &UserOption, skipIncludes) == key);
+
+        // A change of the interface changes the key
+        {
+            std::ofstream f2("incrementalkey.h", std::ios::app);
+            f2 << "void bar();\n";
+        }
+        Tokenizer scanned3;
+        scanned3.scanIncludes("incrementalkey.c", includePaths, skipIncludes, &UserOption, errout);
+        SummarizeHeaders(scanned3, includePaths, skipIncludes, &UserOption, &symbolCache);
+        const FileHash changedKey = symbolCache.resultsKey(scanned3, ownHeaders, &UserOption, skipIncludes);
+        ASSERT(changedKey != 0 && changedKey != key);
+        ASSERT_EQUALS("", errout.str());
+    }
+
     void indentlevel()
     {
         // the indentlevel will be increased too much in the included header.
@@ -258,6 +1136,36 @@ private:
         ASSERT_EQUALS("", errout.str());
     }
 
+    void missingsymbols()
+    {
+        {
+            std::ofstream f1("missingsymbols1.c");
+            f1 << "#include \"missingsymbols.h\"\n"
+               << "void f() { Fred fred; }\n";
+
+            std::ofstream f2("missingsymbols2.c");
+            f2 << "void f() { Fred fred; }\n";
+
+            std::ofstream f3("missingsymbols.h");
+            f3 << "class Fred { };\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+        SymbolCache symbolCache;
+
+        // Fred is declared in the header..
+        Tokenizer tokenizer1;
+        tokenizer1.tokenize("missingsymbols1.c", includePaths, skipIncludes, &UserOption, errout);
+        ASSERT_EQUALS(0, (int)MissingSymbols(tokenizer1, &symbolCache).count("missingsymbols1.c:Fred"));
+
+        // ..and it is missing without the include
+        Tokenizer tokenizer2;
+        tokenizer2.tokenize("missingsymbols2.c", includePaths, skipIncludes, &UserOption, errout);
+        ASSERT_EQUALS(1, (int)MissingSymbols(tokenizer2, &symbolCache).count("missingsymbols2.c:Fred"));
+    }
+
     void needed_class()
     {
         {
@@ -476,6 +1384,167 @@ private:
         ASSERT_EQUALS("", errout.str());
     }
 
+    void precompiledheader()
+    {
+        {
+            std::ofstream f1("precompiledheader1.c");
+            f1 << "#include \"precompiledheader1.h\"\n"
+               << "#include \"precompiledheader2.h\"\n";
+
+            std::ofstream f2("precompiledheader2.c");
+            f2 << "#include \"precompiledheader1.h\"\n";
+
+            std::ofstream f3("precompiledheader1.h");
+            f3 << "#include \"precompiledheader3.h\"\n"
+               << "void foo();\n";
+
+            std::ofstream f4("precompiledheader2.h");
+            f4 << "void bar();\n";
+
+            std::ofstream f5("precompiledheader3.h");
+            f5 << "void baz();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        IncludeGraph graph;
+        const char *sources[] = { "precompiledheader1.c", "precompiledheader2.c" };
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize(sources[i], includePaths, skipIncludes, &UserOption, errout);
+            graph.add(tokenizer);
+        }
+
+        // precompiledheader1.h is included by both files and precompiledheader2.h by half of them. The
+        // header that precompiledheader1.h includes is not listed..
+        std::map<std::string, unsigned int> changes;
+        std::vector<IncludeGraph::PrecompiledHeader> pchs(graph.precompiledHeaders(changes, 5, 5));
+        ASSERT_EQUALS(1, (int)pchs.size());
+        if (pchs.size() == 1)
+        {
+            ASSERT_EQUALS(".", pchs[0].directory);
+            ASSERT_EQUALS(2, (int)pchs[0].sources);
+            ASSERT_EQUALS(2, (int)pchs[0].headers.size());
+            ASSERT_EQUALS("precompiledheader1.h", pchs[0].headers.empty() ? "" : pchs[0].headers[0]);
+            ASSERT_EQUALS(14, (int)pchs[0].savedTokens);
+        }
+
+        // ..unless it changes often
+        changes["precompiledheader3.h"] = 10;
+        pchs = graph.precompiledHeaders(changes, 5, 5);
+        ASSERT_EQUALS(1, (int)pchs.size());
+        if (pchs.size() == 1)
+        {
+            ASSERT_EQUALS(1, (int)pchs[0].headers.size());
+            ASSERT_EQUALS("precompiledheader2.h", pchs[0].headers.empty() ? "" : pchs[0].headers[0]);
+        }
+    }
+
+    void precompiledheadercost()
+    {
+        {
+            std::ofstream f1("precompiledheadercost1.c");
+            f1 << "#include \"precompiledheadercost1.h\"\n"
+               << "#include \"precompiledheadercost2.h\"\n";
+
+            std::ofstream f2("precompiledheadercost2.c");
+            f2 << "#include \"precompiledheadercost1.h\"\n"
+               << "#include \"precompiledheadercost2.h\"\n";
+
+            std::ofstream f3("precompiledheadercost1.h");
+            f3 << "int version;\n";
+
+            std::ofstream f4("precompiledheadercost2.h");
+            for (unsigned int i = 0; i < 20; ++i)
+                f4 << "void f" << i << "(int a, int b);\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        IncludeGraph graph;
+        const char *sources[] = { "precompiledheadercost1.c", "precompiledheadercost2.c" };
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            Tokenizer tokenizer;
+            tokenizer.tokenize(sources[i], includePaths, skipIncludes, &UserOption, errout);
+            graph.add(tokenizer);
+        }
+
+        // Both headers are included by every file but precompiledheadercost1.h is too cheap
+        std::map<std::string, unsigned int> changes;
+        const std::vector<IncludeGraph::PrecompiledHeader> pchs(graph.precompiledHeaders(changes, 5, 5));
+        ASSERT_EQUALS(1, (int)pchs.size());
+        if (pchs.size() == 1)
+        {
+            ASSERT_EQUALS(1, (int)pchs[0].headers.size());
+            ASSERT_EQUALS("precompiledheadercost2.h", pchs[0].headers.empty() ? "" : pchs[0].headers[0]);
+        }
+    }
+
+    void redundant()
+    {
+        {
+            std::ofstream f1("redundant.c");
+            f1 << "#include \"redundant1.h\"\n"
+               << "#include \"redundant2.h\"\n"
+               << "void f() { Fred fred; Wilma wilma; }\n";
+
+            std::ofstream f2("redundant1.h");
+            f2 << "#include \"redundant2.h\"\n"
+               << "class Fred { Wilma wilma; };\n";
+
+            std::ofstream f3("redundant2.h");
+            f3 << "class Wilma { };\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("redundant.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // The redundant check is not enabled by default..
+        const CheckContext context(&UserOption, NULL, NULL);
+        runChecks(tokenizer, context, errout);
+        ASSERT_EQUALS("", errout.str());
+
+        // redundant2.h is needed but redundant1.h includes it too
+        UserOption.EnabledChecks.insert("redundant");
+        runChecks(tokenizer, context, errout);
+        ASSERT_EQUALS("[redundant.c:2] (style): The included header 'redundant2.h' is redundant via 'redundant1.h'\n", errout.str());
+    }
+
+    void resolveonly()
+    {
+        {
+            std::ofstream f1("resolveonly.c");
+            f1 << "/* #include \"commented.h\" */\n"
+               << "#include \"resolveonly.h\"\n"
+               << "const char *s = \"#include <string.h>\";\n";
+
+            std::ofstream f2("resolveonly.h");
+            f2 << "// #include \"commented.h\"\n"
+               << "#include \"missing.h\"\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.scanIncludes("resolveonly.c", includePaths, skipIncludes, &UserOption, errout);
+
+        ASSERT_EQUALS(2, tokenizer.ShortFileNames.size());
+        ASSERT(tokenizer.tokens == NULL);
+        ASSERT_EQUALS("[resolveonly.h:2] (style): Header not found 'missing.h'. Use -I or --skip to fix this message.\n", errout.str());
+    }
+
     void stdafx()
     {
         {
@@ -503,6 +1572,216 @@ private:
         ASSERT_EQUALS("", errout.str());
     }
 
+    void symbolcache()
+    {
+        {
+            std::ofstream f1("symbolcache.c");
+            f1 << "#include \"symbolcache.h\"\n"
+               << "void f() { bar(); }\n";
+
+            std::ofstream f2("symbolcache.h");
+            f2 << "struct Fred;\n"
+               << "void foo();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        Tokenizer tokenizer;
+        tokenizer.tokenize("symbolcache.c", includePaths, skipIncludes, &UserOption, errout);
+
+        // The symbols are extracted and cached..
+        SymbolCache symbolCache;
+        WarningIncludeHeader(tokenizer, &UserOption, errout, &symbolCache);
+        ASSERT_EQUALS("[symbolcache.c:1] (style): The included header 'symbolcache.h' is not needed\n", errout.str());
+
+        const HeaderSymbols *symbols = symbolCache.find(tokenizer.FileHashes[1]);
+        ASSERT(symbols != NULL);
+        if (symbols)
+        {
+            ASSERT(hasSymbol(symbols->names, symbolCache.getId("foo")));
+            ASSERT(hasSymbol(symbols->declarations, symbolCache.getId("Fred")));
+        }
+
+        // The cached symbols are used instead of the header contents..
+        errout.str("");
+        SymbolCache symbolCache2;
+        symbolCache2.add(tokenizer.FileHashes[1]).names.push_back(symbolCache2.getId("bar"));
+        WarningIncludeHeader(tokenizer, &UserOption, errout, &symbolCache2);
+        ASSERT_EQUALS("", errout.str());
+    }
+
+    void symboldatabase()
+    {
+        {
+            SymbolCache symbolCache;
+            HeaderSymbols &symbols1 = symbolCache.add(1);
+            symbols1.classes.push_back(symbolCache.getId("Fred"));
+            symbols1.names.push_back(symbolCache.getId("foo"));
+            symbols1.declarations.push_back(symbolCache.getId("Wilma"));
+            symbols1.includes.push_back("a.h");
+            symbolCache.add(2).names.push_back(symbolCache.getId("bar"));
+
+            SourceResults results;
+            results.key = 100;
+            results.ownHeaders.push_back("a.h");
+            results.checkedIncludes.push_back("a.h:1");
+            results.messages.push_back("[a.c:1] (style): message");
+            symbolCache.setResults("a.c", results);
+            ASSERT(symbolCache.save("symboldatabase.db", false));
+        }
+
+        // Read symbols from the database and update it..
+        {
+            SymbolCache symbolCache;
+            ASSERT(symbolCache.load("symboldatabase.db"));
+            ASSERT(symbolCache.find(3) == NULL);
+            const HeaderSymbols *symbols1 = symbolCache.find(1);
+            ASSERT(symbols1 != NULL);
+            if (symbols1)
+            {
+                ASSERT(hasSymbol(symbols1->classes, symbolCache.getId("Fred")));
+                ASSERT(hasSymbol(symbols1->names, symbolCache.getId("foo")));
+                ASSERT(hasSymbol(symbols1->declarations, symbolCache.getId("Wilma")));
+                ASSERT_EQUALS(1, symbols1->includes.size());
+            }
+            symbolCache.add(3).names.push_back(symbolCache.getId("baz"));
+
+            ASSERT(symbolCache.findResults("b.c") == NULL);
+            const SourceResults *results = symbolCache.findResults("a.c");
+            ASSERT(results != NULL);
+            if (results)
+            {
+                ASSERT(results->key == 100);
+                ASSERT_EQUALS(1, results->ownHeaders.size());
+                ASSERT_EQUALS(0, results->otherHeaders.size());
+                ASSERT_EQUALS(1, results->checkedIncludes.size());
+                ASSERT_EQUALS(1, results->messages.size());
+            }
+            ASSERT(symbolCache.save("symboldatabase.db", false));
+        }
+
+        // Compact the database..
+        {
+            SymbolCache symbolCache;
+            ASSERT(symbolCache.load("symboldatabase.db"));
+            ASSERT(symbolCache.find(2) != NULL);
+            ASSERT(symbolCache.find(3) != NULL);
+            ASSERT(symbolCache.save("symboldatabase.db", true));
+        }
+
+        {
+            SymbolCache symbolCache;
+            ASSERT(symbolCache.load("symboldatabase.db"));
+            ASSERT(symbolCache.find(1) == NULL);
+            ASSERT(symbolCache.find(2) != NULL);
+            ASSERT(symbolCache.find(3) != NULL);
+            ASSERT(symbolCache.findResults("a.c") == NULL);
+        }
+
+        // Invalid database..
+        {
+            std::ofstream f("symboldatabase.db");
+            f << "invalid";
+        }
+        SymbolCache symbolCache;
+        ASSERT(!symbolCache.load("symboldatabase.db"));
+    }
+
+    void exportgraph()
+    {
+        {
+            std::ofstream f1("exportgraph.c");
+            f1 << "#include \"exportgraph1.h\"\n"
+               << "#include \"exportgraph3.h\"\n";
+
+            std::ofstream f2("exportgraph1.h");
+            f2 << "#include \"exportgraph2.h\"\n";
+
+            std::ofstream f3("exportgraph2.h");
+            f3 << "#include \"exportgraph1.h\"\n";
+
+            std::ofstream f4("exportgraph3.h");
+            f4 << "void f();\n";
+        }
+
+        std::ostringstream errout;
+        Options UserOption;
+        UserOption.Progress = false;
+
+        IncludeGraph graph;
+        Tokenizer tokenizer;
+        tokenizer.tokenize("exportgraph.c", includePaths, skipIncludes, &UserOption, errout);
+        std::set<std::string> unneededIncludes;
+        unneededIncludes.insert("exportgraph.c:2");
+        graph.add(tokenizer, &unneededIncludes);
+
+        // The headers that include each other are a cycle..
+        const std::vector< std::vector<std::string> > cycles(graph.cycles());
+        ASSERT_EQUALS(1, (int)cycles.size());
+        if (cycles.size() == 1)
+        {
+            ASSERT_EQUALS(2, (int)cycles[0].size());
+            ASSERT_EQUALS("exportgraph1.h", cycles[0][0]);
+            ASSERT_EQUALS("exportgraph2.h", cycles[0][1]);
+        }
+
+        // ..and the includes in the cycle are not followed when the depth is calculated
+        std::map<std::string, IncludeGraph::FileMetrics> metrics(graph.metrics());
+        ASSERT_EQUALS(1, (int)metrics["exportgraph.c"].depth);
+        ASSERT_EQUALS(0, (int)metrics["exportgraph.c"].fanIn);
+        ASSERT_EQUALS(2, (int)metrics["exportgraph.c"].fanOut);
+        ASSERT_EQUALS(0, (int)metrics["exportgraph1.h"].depth);
+        ASSERT_EQUALS(2, (int)metrics["exportgraph1.h"].fanIn);
+        ASSERT_EQUALS(1, (int)metrics["exportgraph1.h"].fanOut);
+
+        // The unneeded include is marked in the exported graph
+        std::ostringstream dot;
+        graph.writeDot(dot);
+        ASSERT(dot.str().find("\"exportgraph.c\" -> \"exportgraph1.h\" [label=\"1\"];\n") != std::string::npos);
+        ASSERT(dot.str().find("\"exportgraph.c\" -> \"exportgraph3.h\" [label=\"2\", style=dashed, color=red];\n") != std::string::npos);
+
+        std::ostringstream json;
+        graph.writeJson(json);
+        ASSERT(json.str().find("{\"from\": \"exportgraph.c\", \"line\": 2, \"header\": \"exportgraph3.h\", \"to\": \"exportgraph3.h\", \"unneeded\": true}") != std::string::npos);
+        ASSERT(json.str().find("\"cycles\": [\n    [\"exportgraph1.h\", \"exportgraph2.h\"]\n  ]") != std::string::npos);
+    }
+
+    void fingerprint()
+    {
+        SymbolCache symbolCache;
+
+        // The fingerprint doesn't depend on the order of the symbols..
+        HeaderSymbols &symbols1 = symbolCache.add(1);
+        symbols1.names.push_back(symbolCache.getId("foo"));
+        symbols1.names.push_back(symbolCache.getId("bar"));
+        symbols1.includes.push_back("<a.h>");
+
+        HeaderSymbols &symbols2 = symbolCache.add(2);
+        symbols2.names.push_back(symbolCache.getId("bar"));
+        symbols2.names.push_back(symbolCache.getId("foo"));
+        symbols2.includes.push_back("<a.h>");
+
+        ASSERT(symbolCache.getFingerprint(1) != 0);
+        ASSERT(symbolCache.getFingerprint(1) == symbolCache.getFingerprint(2));
+
+        // ..but it depends on the kind of symbols and on the includes
+        HeaderSymbols &symbols3 = symbolCache.add(3);
+        symbols3.classes.push_back(symbolCache.getId("bar"));
+        symbols3.names.push_back(symbolCache.getId("foo"));
+        symbols3.includes.push_back("<a.h>");
+        ASSERT(symbolCache.getFingerprint(1) != symbolCache.getFingerprint(3));
+
+        HeaderSymbols &symbols4 = symbolCache.add(4);
+        symbols4.names.push_back(symbolCache.getId("bar"));
+        symbols4.names.push_back(symbolCache.getId("foo"));
+        symbols4.includes.push_back("a.h");
+        ASSERT(symbolCache.getFingerprint(1) != symbolCache.getFingerprint(4));
+
+        ASSERT(symbolCache.getFingerprint(5) == 0);
+    }
+
     void standardheader1()
     {
         {